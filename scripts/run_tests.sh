@@ -40,4 +40,25 @@ echo "  $ test_mmap"
 echo "  $ test-shared1"
 echo "  $ test-shared2"
 echo "  $ test_cow"
+echo "  $ test_textshare"
+echo "  $ test_zygote"
+echo "  $ test_cowadapt"
+echo "  $ test_bootstat"
+echo "  $ test_stackgrow"
+echo "  $ test_mlfq"
+echo "  $ test_threads"
+echo "  $ test_futex"
+echo "  $ test_lockstress"
+echo "  $ test_lockstat"
+echo "  $ lockstat test_lockstress"
+echo "  $ test_prof"
+echo "  $ prof test_lockstress"
+echo "  $ test_trace"
+echo "  $ trace test_futex"
+echo "  $ test_syscallstat"
+echo "  $ syscallstat usertests"
+echo "  $ test_rusage"
+echo "  $ time usertests"
+echo "  $ test_runq"
+echo "  $ test_childfirst"
 echo ""
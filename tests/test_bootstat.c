@@ -0,0 +1,55 @@
+// Test program for boot timing
+// Tests that getbootstat() reports the boot phases in order and
+// that every CPU was brought up
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "bootstat.h"
+
+char *phasename[NBOOTPHASE] = {
+    "kinit1", "devices", "startothers", "kinit2", "userinit",
+};
+
+int main(int argc, char *argv[]) {
+    struct bootstat st;
+    int i, ok;
+
+    printf(1, "Boot Timing Test\n");
+    printf(1, "================\n");
+
+    if (getbootstat(&st) < 0) {
+        printf(1, "ERROR: getbootstat failed!\n");
+        exit();
+    }
+
+    printf(1, "\nBoot phases (Kcycles since main):\n");
+    ok = 1;
+    for (i = 0; i < NBOOTPHASE; i++) {
+        printf(1, "  %s: %d\n", phasename[i], st.phase[i]);
+        if (i > 0 && st.phase[i] < st.phase[i-1])
+            ok = 0;
+    }
+    if (ok) {
+        printf(1, "✓ PASS: Phases are in order\n");
+    } else {
+        printf(1, "✗ FAIL: Phases out of order\n");
+    }
+
+    printf(1, "\nCPUs entering the scheduler (Kcycles since main):\n");
+    ok = 1;
+    for (i = 0; i < st.ncpu && i < NCPU; i++) {
+        printf(1, "  cpu%d: %d\n", i, st.cpu[i]);
+        if (st.cpu[i] == 0)
+            ok = 0;
+    }
+    if (ok) {
+        printf(1, "✓ PASS: All %d CPUs started\n", st.ncpu);
+    } else {
+        printf(1, "✗ FAIL: Some CPUs never started\n");
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
@@ -0,0 +1,122 @@
+// Test program for futexes
+// Tests futex_wait/futex_wake between processes sharing a
+// mapshared() page, and the mutex and condition variable built
+// on them between threads
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NTHREAD 4
+#define NINCR 10000
+#define NITEM 100
+
+mutex_t mutex;
+cond_t cond;
+int counter;
+int items, consumed;
+
+void adder(void *arg) {
+    int i;
+
+    for (i = 0; i < NINCR; i++) {
+        mutex_lock(&mutex);
+        counter++;
+        mutex_unlock(&mutex);
+    }
+    exit();
+}
+
+void consumer(void *arg) {
+    mutex_lock(&mutex);
+    while (consumed < NITEM) {
+        while (items == 0 && consumed < NITEM)
+            cond_wait(&cond, &mutex);
+        if (items > 0) {
+            items--;
+            consumed++;
+        }
+    }
+    mutex_unlock(&mutex);
+    cond_broadcast(&cond);
+    exit();
+}
+
+int main(int argc, char *argv[]) {
+    volatile uint *word;
+    int i, pid, woken;
+
+    printf(1, "Futex Test\n");
+    printf(1, "==========\n");
+
+    printf(1, "\nWaking a process sleeping on a shared page...\n");
+    word = mapshared();
+    if (word == 0) {
+        printf(1, "ERROR: mapshared failed!\n");
+        exit();
+    }
+    if (futex_wait(word, 1) == 0) {
+        printf(1, "✓ PASS: futex_wait returns at once if the word changed\n");
+    } else {
+        printf(1, "✗ FAIL: futex_wait on a valid word failed\n");
+    }
+
+    pid = fork();
+    if (pid < 0) {
+        printf(1, "ERROR: fork failed!\n");
+        exit();
+    }
+    if (pid == 0) {
+        while (*word == 0)
+            futex_wait(word, 0);
+        exit();
+    }
+    woken = 0;
+    for (i = 0; i < 100 && woken == 0; i++) {
+        sleep(1);  // let the child go to sleep
+        *word = 1;
+        woken = futex_wake(word, 1);
+    }
+    wait();
+    if (woken == 1) {
+        printf(1, "✓ PASS: futex_wake woke the child through the shared page\n");
+    } else {
+        printf(1, "✗ FAIL: futex_wake woke %d processes\n", woken);
+    }
+    unmapshared();
+
+    printf(1, "\nRunning %d threads of %d mutex increments...\n",
+           NTHREAD, NINCR);
+    mutex_init(&mutex);
+    for (i = 0; i < NTHREAD; i++)
+        thread_create(adder, 0);
+    while (thread_join() > 0)
+        ;
+    if (counter == NTHREAD * NINCR) {
+        printf(1, "✓ PASS: Mutex kept the counter exact (%d)\n", counter);
+    } else {
+        printf(1, "✗ FAIL: Counter is %d, expected %d\n", counter,
+               NTHREAD * NINCR);
+    }
+
+    printf(1, "\nProducing %d items for %d consumers...\n", NITEM, NTHREAD);
+    cond_init(&cond);
+    for (i = 0; i < NTHREAD; i++)
+        thread_create(consumer, 0);
+    for (i = 0; i < NITEM; i++) {
+        mutex_lock(&mutex);
+        items++;
+        mutex_unlock(&mutex);
+        cond_signal(&cond);
+    }
+    while (thread_join() > 0)
+        ;
+    if (consumed == NITEM && items == 0) {
+        printf(1, "✓ PASS: Condition variable delivered every item\n");
+    } else {
+        printf(1, "✗ FAIL: %d items consumed, %d left\n", consumed, items);
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
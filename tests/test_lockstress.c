@@ -0,0 +1,76 @@
+// Stress test for the kernel spin locks
+// Runs one fork/fault loop per CPU (boot with CPUS=8) for a fixed
+// time and reports total throughput and how evenly it was shared,
+// which with FIFO (ticket and MCS) locks should stay close
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define PGSIZE 4096
+#define NWORKER 8
+#define DURATION 300  // ticks
+
+// Fork and reap a child, then fault in and free a heap page,
+// until the deadline; report the rounds done.
+void worker(int deadline, int fd) {
+    int n, pid;
+    char *p;
+
+    for (n = 0; uptime() < deadline; n++) {
+        if ((pid = fork()) == 0)
+            exit();
+        if (pid > 0)
+            wait();
+        if ((p = sbrk(PGSIZE)) != (char*)-1) {
+            p[0] = 1;
+            sbrk(-PGSIZE);
+        }
+    }
+    write(fd, &n, sizeof(n));
+    exit();
+}
+
+int main(int argc, char *argv[]) {
+    int i, n, fds[2], deadline;
+    int total, min, max;
+
+    printf(1, "Spin Lock Stress Test\n");
+    printf(1, "=====================\n");
+
+    printf(1, "\nRunning %d fork/fault loops for %d ticks...\n",
+           NWORKER, DURATION);
+    pipe(fds);
+    deadline = uptime() + DURATION;
+    for (i = 0; i < NWORKER; i++) {
+        if (fork() == 0)
+            worker(deadline, fds[1]);
+    }
+    close(fds[1]);
+
+    total = max = 0;
+    min = -1;
+    for (i = 0; i < NWORKER && read(fds[0], &n, sizeof(n)) == sizeof(n); i++) {
+        total += n;
+        if (n > max)
+            max = n;
+        if (min < 0 || n < min)
+            min = n;
+    }
+    while (wait() > 0)
+        ;
+
+    printf(1, "Rounds: total %d, %d per 100 ticks\n", total,
+           total * 100 / DURATION);
+    printf(1, "Per loop: min %d, max %d, fairness %d%%\n", min, max,
+           max ? min * 100 / max : 0);
+
+    if (i == NWORKER && min > 0) {
+        printf(1, "✓ PASS: Every loop made progress\n");
+    } else {
+        printf(1, "✗ FAIL: A loop starved (%d reported, min %d)\n", i, min);
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
@@ -0,0 +1,125 @@
+// Test program for the MLFQ scheduler
+// Benchmarks the wakeup latency of an I/O-bound process competing
+// with CPU-bound ones, under MLFQ and with every process pinned to
+// the bottom level, which makes it plain round robin, and checks
+// that the CPU-bound processes are moved down the levels
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "bootstat.h"
+#include "schedstat.h"
+
+#define NSLEEP 50
+
+int nhog;  // two CPU hogs per CPU, so none is left idle
+
+// Sleep one tick NSLEEP times; return the worst and total number
+// of ticks overslept, via a pipe.
+void interactive(int fd) {
+    int i, t0, late, res[2];
+
+    res[0] = res[1] = 0;
+    for (i = 0; i < NSLEEP; i++) {
+        t0 = uptime();
+        sleep(1);
+        late = uptime() - t0 - 1;
+        if (late > res[0])
+            res[0] = late;
+        res[1] += late;
+    }
+    write(fd, res, sizeof(res));
+    exit();
+}
+
+// Run the interactive process against nhog CPU hogs, all started
+// at the given nice level.  Returns its total latency; sets
+// *demoted if a hog was seen below that level.
+int bench(char *name, int nice, int *demoted) {
+    int i, pid, hogs[2*NCPU], fds[2], res[2];
+    struct schedstat st;
+
+    // Children inherit the nice level.
+    setpriority(getpid(), nice);
+    for (i = 0; i < nhog; i++) {
+        if ((hogs[i] = fork()) == 0)
+            for (;;)
+                ;
+    }
+
+    pipe(fds);
+    if ((pid = fork()) == 0)
+        interactive(fds[1]);
+    setpriority(getpid(), 0);
+    while (read(fds[0], res, sizeof(res)) != sizeof(res))
+        ;
+    for (i = 0; i < nhog; i++) {
+        if (getschedstat(hogs[i], &st) == 0 && st.level > nice)
+            *demoted = 1;
+    }
+    wait();
+    close(fds[0]);
+    close(fds[1]);
+
+    for (i = 0; i < nhog; i++)
+        kill(hogs[i]);
+    for (i = 0; i < nhog; i++)
+        wait();
+
+    printf(1, "%s: worst latency %d ticks, total %d ticks over %d sleeps\n",
+           name, res[0], res[1], NSLEEP);
+    return res[1];
+}
+
+int main(int argc, char *argv[]) {
+    int rr, mlfq, demoted, old;
+    struct schedstat st;
+    struct bootstat bs;
+
+    printf(1, "MLFQ Scheduler Test\n");
+    printf(1, "===================\n");
+
+    printf(1, "\nsetpriority() and getschedstat()...\n");
+    old = setpriority(getpid(), 1);
+    if (old == 0 && setpriority(getpid(), 0) == 1 &&
+        setpriority(getpid(), NMLFQ) < 0) {
+        printf(1, "✓ PASS: setpriority returns the old level and checks its range\n");
+    } else {
+        printf(1, "✗ FAIL: setpriority misbehaves\n");
+    }
+    if (getschedstat(0, &st) == 0 && st.switches > 0) {
+        printf(1, "✓ PASS: getschedstat reports %d switches, %d run ticks, %d wait ticks\n",
+               st.switches, st.runticks, st.waitticks);
+    } else {
+        printf(1, "✗ FAIL: getschedstat failed\n");
+    }
+
+    bs.ncpu = 1;
+    getbootstat(&bs);
+    nhog = 2 * bs.ncpu;
+    printf(1, "\nSleeping against %d CPU hogs...\n", nhog);
+    demoted = 0;
+    rr = bench("round robin", NMLFQ - 1, &demoted);
+    if (demoted) {
+        printf(1, "✗ FAIL: CPU hogs left the bottom level\n");
+        demoted = 0;
+    }
+    mlfq = bench("MLFQ", 0, &demoted);
+
+    if (demoted) {
+        printf(1, "✓ PASS: CPU hogs moved down the levels\n");
+    } else {
+        printf(1, "✗ FAIL: CPU hogs stayed at the top level\n");
+    }
+    if (mlfq < rr) {
+        printf(1, "✓ PASS: MLFQ cut the total latency (%d vs %d ticks round robin)\n",
+               mlfq, rr);
+    } else {
+        printf(1, "✗ FAIL: MLFQ did not beat round robin (%d vs %d ticks)\n",
+               mlfq, rr);
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
@@ -0,0 +1,108 @@
+// Test program for on-demand user stack growth
+// Tests that the stack grows on faults below it, that a touch far
+// below the stack maps only that page, that system calls may use stack
+// memory not touched yet, and that running past the stack reserve
+// kills the process
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define PGSIZE 4096
+#define FRAME 1024
+#define DEPTH 256   // 256KB of stack
+#define FAR 128     // pages in the far-reaching frame
+
+int recurse(int n) {
+    volatile char frame[FRAME];
+
+    frame[0] = n;
+    frame[FRAME-1] = n;
+    if (n == 0)
+        return 0;
+    return recurse(n - 1) + frame[0] - frame[FRAME-1] + 1;
+}
+
+int forever(int n) {
+    volatile char frame[FRAME];
+
+    frame[0] = n;
+    return forever(n + 1) + frame[0];
+}
+
+// Touch only the far end of a 512KB frame.
+int touchfar(void) {
+    volatile char buf[FAR*PGSIZE];
+
+    buf[0] = 1;
+    return buf[0];
+}
+
+int readbig(int fd) {
+    char buf[8*PGSIZE];  // never touched by user code before read()
+
+    if (read(fd, buf, 6) != 6)
+        return 0;
+    return strcmp(buf, "hello") == 0;
+}
+
+int main(int argc, char *argv[]) {
+    int before, after, pid, fds[2];
+
+    printf(1, "Stack Growth Test\n");
+    printf(1, "=================\n");
+
+    printf(1, "\nReading into an untouched stack buffer...\n");
+    pipe(fds);
+    write(fds[1], "hello", 6);
+    if (readbig(fds[0])) {
+        printf(1, "✓ PASS: System call filled stack pages on demand\n");
+    } else {
+        printf(1, "✗ FAIL: read into the stack buffer failed\n");
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    printf(1, "\nTouching the bottom of a %d-page frame...\n", FAR);
+    before = numpp();
+    touchfar();
+    after = numpp();
+    printf(1, "Physical pages before = %d, after = %d\n", before, after);
+    if (after - before < 8) {
+        printf(1, "✓ PASS: Only the touched stack page was mapped\n");
+    } else {
+        printf(1, "✗ FAIL: %d pages mapped for one touch\n", after - before);
+    }
+
+    printf(1, "\nRecursing %d frames of %d bytes...\n", DEPTH, FRAME);
+    before = numpp();
+    if (recurse(DEPTH) == DEPTH) {
+        printf(1, "✓ PASS: Deep recursion ran correctly\n");
+    } else {
+        printf(1, "✗ FAIL: Deep recursion returned a wrong result\n");
+    }
+    after = numpp();
+    printf(1, "Physical pages before = %d, after = %d\n", before, after);
+    if (after - before >= DEPTH * FRAME / PGSIZE - 8) {
+        printf(1, "✓ PASS: Stack grew to fit the recursion\n");
+    } else {
+        printf(1, "✗ FAIL: Stack did not grow as expected\n");
+    }
+
+    printf(1, "\nRecursing without bound in a child...\n");
+    pid = fork();
+    if (pid < 0) {
+        printf(1, "ERROR: fork failed!\n");
+        exit();
+    }
+    if (pid == 0) {
+        forever(0);
+        printf(1, "✗ FAIL: Child survived running off its stack\n");
+        exit();
+    }
+    wait();
+    printf(1, "✓ PASS: Child was killed at the end of the stack reserve\n");
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
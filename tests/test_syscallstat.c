@@ -0,0 +1,83 @@
+// Test program for system call statistics
+// Tests that syscallstat() counts calls and keeps latency histograms
+// consistent with the counts
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "syscall.h"
+#include "syscallstat.h"
+
+#define NCALLS 100
+#define NFORKS 10
+
+struct syscallstat before[NSYSCALL], after[NSYSCALL];
+
+// Mean cycles of the calls of num between the snapshots.
+uint mean(int num) {
+    uint64 c = after[num].cycles - before[num].cycles;
+    uint n = after[num].calls - before[num].calls;
+
+    return n ? (uint)c / n : 0;
+}
+
+int main(int argc, char *argv[]) {
+    int i, b, sum, n, bad;
+
+    printf(1, "System Call Statistics Test\n");
+    printf(1, "===========================\n");
+
+    if (syscallstat(before, NSYSCALL + 1) < 0) {
+        printf(1, "✓ PASS: Oversized request rejected\n");
+    } else {
+        printf(1, "✗ FAIL: syscallstat accepted n > NSYSCALL\n");
+    }
+
+    n = syscallstat(before, NSYSCALL);
+    printf(1, "\nCalling getpid %d times and forking %d times...\n",
+           NCALLS, NFORKS);
+    for (i = 0; i < NCALLS; i++)
+        getpid();
+    for (i = 0; i < NFORKS; i++) {
+        if (fork() == 0)
+            exit();
+        wait();
+    }
+    syscallstat(after, NSYSCALL);
+
+    printf(1, "getpid calls: %d, fork calls: %d\n",
+           after[SYS_getpid].calls - before[SYS_getpid].calls,
+           after[SYS_fork].calls - before[SYS_fork].calls);
+    if (n > SYS_syscallstat &&
+        after[SYS_getpid].calls - before[SYS_getpid].calls == NCALLS &&
+        after[SYS_fork].calls - before[SYS_fork].calls == NFORKS) {
+        printf(1, "✓ PASS: Calls were counted per system call\n");
+    } else {
+        printf(1, "✗ FAIL: Wrong call counts\n");
+    }
+
+    bad = 0;
+    for (i = 0; i < NSYSCALL; i++) {
+        sum = 0;
+        for (b = 0; b < NSYSHIST; b++)
+            sum += after[i].hist[b];
+        if (sum != after[i].calls)
+            bad = 1;
+    }
+    if (!bad) {
+        printf(1, "✓ PASS: Histograms add up to the call counts\n");
+    } else {
+        printf(1, "✗ FAIL: A histogram does not match its count\n");
+    }
+
+    printf(1, "Mean cycles: getpid %d, fork %d\n",
+           mean(SYS_getpid), mean(SYS_fork));
+    if (mean(SYS_getpid) > 0 && mean(SYS_fork) > mean(SYS_getpid)) {
+        printf(1, "✓ PASS: fork is slower than getpid\n");
+    } else {
+        printf(1, "✗ FAIL: Latencies look wrong\n");
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
@@ -0,0 +1,64 @@
+// Test program for shared program text
+// Tests that exec maps file-backed pages from the text cache and that
+// writes to them are made private through CoW
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define PGSIZE 4096
+
+// Initialized, so it is loaded from the file rather than zero-filled.
+char data[PGSIZE] __attribute__((aligned(PGSIZE))) = { 'A' };
+
+int main(int argc, char *argv[]) {
+    int before, after;
+    char *args[] = { "test_textshare", "child", 0 };
+
+    if (argc > 1) {
+        // Exec'd copy: the page must still hold the file contents.
+        if (data[0] == 'A') {
+            printf(1, "✓ PASS: Second instance sees the original file contents\n");
+        } else {
+            printf(1, "✗ FAIL: Second instance sees '%c'\n", data[0]);
+        }
+        exit();
+    }
+
+    printf(1, "Shared Program Text Test\n");
+    printf(1, "========================\n");
+
+    printf(1, "\nWriting to an initialized data page...\n");
+    before = getNumFreePages();
+    data[0] = 'B';
+    after = getNumFreePages();
+    printf(1, "Free pages before = %d, after = %d\n", before, after);
+
+    if (before - after == 1) {
+        printf(1, "✓ PASS: Page was shared with the text cache and copied on write\n");
+    } else {
+        printf(1, "✗ FAIL: Expected 1 page consumed, got %d\n", before - after);
+    }
+
+    printf(1, "\nRunning a second instance...\n");
+    int pid = fork();
+    if (pid < 0) {
+        printf(1, "ERROR: fork failed!\n");
+        exit();
+    }
+    if (pid == 0) {
+        exec("test_textshare", args);
+        printf(1, "ERROR: exec failed!\n");
+        exit();
+    }
+    wait();
+
+    if (data[0] == 'B') {
+        printf(1, "✓ PASS: First instance kept its private copy\n");
+    } else {
+        printf(1, "✗ FAIL: First instance lost its write\n");
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
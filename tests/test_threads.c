@@ -0,0 +1,88 @@
+// Test program for clone() threads
+// Tests that threads share memory and heap growth, that join() reaps
+// them and that wait() leaves them alone
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define PGSIZE 4096
+#define NTHREAD 4
+#define NINCR 10000
+
+lock_t lock;
+int counter;
+char *grown;
+
+void adder(void *arg) {
+    int i;
+
+    for (i = 0; i < NINCR; i++) {
+        lock_acquire(&lock);
+        counter++;
+        lock_release(&lock);
+    }
+    exit();
+}
+
+void grower(void *arg) {
+    grown = sbrk(PGSIZE);
+    if (grown != (char*)-1)
+        grown[0] = *(char*)arg;
+    exit();
+}
+
+int main(int argc, char *argv[]) {
+    int i, before, after, joined;
+    char c = 'T';
+
+    printf(1, "Thread Test\n");
+    printf(1, "===========\n");
+
+    printf(1, "\nRunning %d threads of %d locked increments...\n",
+           NTHREAD, NINCR);
+    lock_init(&lock);
+    before = getNumFreePages();
+    for (i = 0; i < NTHREAD; i++) {
+        if (thread_create(adder, 0) < 0) {
+            printf(1, "ERROR: thread_create failed!\n");
+            exit();
+        }
+    }
+    after = getNumFreePages();
+    printf(1, "Free pages before = %d, after = %d\n", before, after);
+
+    if (wait() < 0) {
+        printf(1, "✓ PASS: wait() ignores threads\n");
+    } else {
+        printf(1, "✗ FAIL: wait() reaped a thread\n");
+    }
+
+    joined = 0;
+    while (thread_join() > 0)
+        joined++;
+
+    if (joined == NTHREAD) {
+        printf(1, "✓ PASS: join() reaped all %d threads\n", joined);
+    } else {
+        printf(1, "✗ FAIL: join() reaped %d threads\n", joined);
+    }
+    if (counter == NTHREAD * NINCR) {
+        printf(1, "✓ PASS: Threads shared the counter (%d)\n", counter);
+    } else {
+        printf(1, "✗ FAIL: Counter is %d, expected %d\n", counter,
+               NTHREAD * NINCR);
+    }
+
+    printf(1, "\nGrowing the heap from a thread...\n");
+    thread_create(grower, &c);
+    thread_join();
+    if (grown != (char*)-1 && grown[0] == c && sbrk(0) == grown + PGSIZE) {
+        printf(1, "✓ PASS: Heap growth is shared\n");
+    } else {
+        printf(1, "✗ FAIL: Heap growth not visible to the main thread\n");
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
@@ -0,0 +1,140 @@
+// Test program for kernel tracing
+// Tests that /trace records system calls, page faults, context
+// switches and disk activity, and stops when told to
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "param.h"
+#include "syscall.h"
+#include "trace.h"
+
+#define NEV (NCPU*NTRACE + NCPU)
+
+struct traceev ev[NEV];
+char page[4096];
+
+int main(int argc, char *argv[]) {
+    int fd, wfd, i, n, pid, child;
+    int sys = 0, fault = 0, out = 0, in = 0, disk = 0, commit = 0, order = 1;
+    uint64 last[NCPU];
+
+    printf(1, "Kernel Trace Test\n");
+    printf(1, "=================\n");
+
+    if ((fd = open("trace", O_RDWR)) < 0) {
+        printf(1, "ERROR: cannot open /trace!\n");
+        exit();
+    }
+
+    if (write(fd, "x", 1) < 0) {
+        printf(1, "✓ PASS: Unknown control byte rejected\n");
+    } else {
+        printf(1, "✗ FAIL: Control byte 'x' accepted\n");
+    }
+
+    printf(1, "\nTracing a fork, a CoW write, a sleep and a file write...\n");
+    page[0] = 1;
+    write(fd, "1", 1);
+    pid = getpid();
+    child = fork();
+    if (child < 0) {
+        printf(1, "ERROR: fork failed!\n");
+        exit();
+    }
+    if (child == 0) {
+        page[0] = 2;  // CoW fault
+        exit();
+    }
+    wait();
+    sleep(2);
+    if ((wfd = open("tracetmp", O_CREATE | O_RDWR)) >= 0) {
+        write(wfd, page, sizeof(page));
+        close(wfd);
+    }
+    unlink("tracetmp");
+    write(fd, "0", 1);
+
+    n = 0;
+    while ((i = read(fd, (char*)&ev[n], (NEV - n) * sizeof(ev[0]))) > 0)
+        n += i / sizeof(ev[0]);
+    printf(1, "Events: %d\n", n);
+
+    for (i = 0; i < NCPU; i++)
+        last[i] = 0;
+    for (i = 0; i < n; i++) {
+        if (ev[i].type == TR_LOST)
+            continue;
+        if (ev[i].cpu >= NCPU || ev[i].tsc < last[ev[i].cpu])
+            order = 0;
+        else
+            last[ev[i].cpu] = ev[i].tsc;
+        switch (ev[i].type) {
+        case TR_SYSCALL:
+            if (ev[i].pid == pid && ev[i].arg[0] == SYS_getpid &&
+                ev[i].arg[1] == pid)
+                sys++;
+            break;
+        case TR_PGFLT:
+            if (ev[i].pid == child && ev[i].arg[0] == (uint)page)
+                fault++;
+            break;
+        case TR_SWTCHOUT:
+            if (ev[i].pid == pid)
+                out++;
+            break;
+        case TR_SWTCHIN:
+            if (ev[i].pid == pid)
+                in++;
+            break;
+        case TR_DISK:
+            disk++;
+            break;
+        case TR_COMMIT:
+            commit++;
+            break;
+        }
+    }
+
+    if (sys == 1) {
+        printf(1, "✓ PASS: getpid() traced with its return value\n");
+    } else {
+        printf(1, "✗ FAIL: Expected 1 getpid event, got %d\n", sys);
+    }
+
+    if (fault >= 1) {
+        printf(1, "✓ PASS: Child's CoW fault traced at its address\n");
+    } else {
+        printf(1, "✗ FAIL: No page fault event from the child\n");
+    }
+
+    if (out >= 1 && in >= 1) {
+        printf(1, "✓ PASS: Context switches traced (out %d, in %d)\n", out, in);
+    } else {
+        printf(1, "✗ FAIL: Missing context switch events\n");
+    }
+
+    if (disk >= 1 && commit >= 1) {
+        printf(1, "✓ PASS: Disk I/O and log commits traced\n");
+    } else {
+        printf(1, "✗ FAIL: disk %d, commit %d events\n", disk, commit);
+    }
+
+    if (order) {
+        printf(1, "✓ PASS: Each CPU's events are in TSC order\n");
+    } else {
+        printf(1, "✗ FAIL: Events out of order\n");
+    }
+
+    getpid();
+    if (read(fd, (char*)ev, sizeof(ev[0])) == 0) {
+        printf(1, "✓ PASS: Nothing traced after stopping\n");
+    } else {
+        printf(1, "✗ FAIL: Events recorded after stopping\n");
+    }
+    close(fd);
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
@@ -0,0 +1,79 @@
+// Test program for zygote templates
+// Tests that spawn_from() clones a template's initialized memory
+// copy-on-write and starts the clone at the given entry point
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define PGSIZE 4096
+#define NPAGES 128
+#define NWORKERS 3
+
+char *state;
+
+void worker(void) {
+    int i, ok = 1;
+
+    for (i = 0; i < NPAGES; i++)
+        if (state[i*PGSIZE] != 'a' + i)
+            ok = 0;
+
+    // Private to this clone; the template and siblings keep 'a'.
+    state[0] = 'X';
+
+    if (ok) {
+        printf(1, "✓ PASS: Worker %d sees the template's state\n", getpid());
+    } else {
+        printf(1, "✗ FAIL: Worker %d sees corrupted state\n", getpid());
+    }
+    exit();
+}
+
+int main(int argc, char *argv[]) {
+    int i, tpid, pid, before, after;
+
+    printf(1, "Zygote Template Test\n");
+    printf(1, "====================\n");
+
+    tpid = fork();
+    if (tpid < 0) {
+        printf(1, "ERROR: fork failed!\n");
+        exit();
+    }
+    if (tpid == 0) {
+        // Template: expensive initialization, then park.
+        state = sbrk(NPAGES * PGSIZE);
+        for (i = 0; i < NPAGES; i++)
+            state[i*PGSIZE] = 'a' + i;
+        zygote();
+        exit();
+    }
+
+    printf(1, "\nSpawning %d workers from template %d...\n", NWORKERS, tpid);
+    for (i = 0; i < NWORKERS; i++) {
+        before = getNumFreePages();
+        while ((pid = spawn_from(tpid, worker)) < 0)
+            sleep(1);  // template still initializing
+        after = getNumFreePages();
+        if (before - after < NPAGES) {
+            printf(1, "✓ PASS: Spawn %d did not copy the template's pages\n", pid);
+        } else {
+            printf(1, "✗ FAIL: Spawn %d consumed %d pages\n", pid, before - after);
+        }
+        if (wait() != pid)
+            printf(1, "✗ FAIL: Worker %d not reaped by its spawner\n", pid);
+    }
+
+    if (spawn_from(getpid(), worker) < 0) {
+        printf(1, "✓ PASS: A non-template process cannot be spawned from\n");
+    } else {
+        printf(1, "✗ FAIL: Spawned from a non-template process\n");
+    }
+
+    kill(tpid);
+    wait();
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
@@ -21,6 +21,8 @@
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "mmu.h"
+#include "proc.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "fs.h"
@@ -40,7 +42,7 @@ binit(void)
 {
   struct buf *b;
 
-  initlock(&bcache.lock, "bcache");
+  initmcslock(&bcache.lock, "bcache");
 
 //PAGEBREAK!
   // Create linked list of buffers
@@ -101,6 +103,8 @@ bread(uint dev, uint blockno)
   b = bget(dev, blockno);
   if((b->flags & B_VALID) == 0) {
     iderw(b);
+    if(myproc())
+      myproc()->inblock++;
   }
   return b;
 }
@@ -12,15 +12,20 @@
 
 #define SECTSIZE  512
 
-void readseg(uchar*, uint, uint);
+static void readseg(uchar*, uint, uint);
+
+// Where the last readseg() stopped: the address and disk sector
+// just past the last sector it read.
+static uchar *lastpa;
+static uint lastsect;
 
 void
 bootmain(void)
 {
   struct elfhdr *elf;
   struct proghdr *ph, *eph;
-  void (*entry)(void);
-  uchar* pa;
+  void (*entry)(void) __attribute__((noreturn));
+  uchar *pa;
 
   elf = (struct elfhdr*)0x10000;  // scratch space
 
@@ -37,13 +42,12 @@ bootmain(void)
   for(; ph < eph; ph++){
     pa = (uchar*)ph->paddr;
     readseg(pa, ph->filesz, ph->off);
-    if(ph->memsz > ph->filesz)
-      stosb(pa + ph->filesz, 0, ph->memsz - ph->filesz);
+    stosb(pa + ph->filesz, 0, ph->memsz - ph->filesz);  // memsz >= filesz
   }
 
   // Call the entry point from the ELF header.
   // Does not return!
-  entry = (void(*)(void))(elf->entry);
+  entry = (void*)elf->entry;
   entry();
 }
 
@@ -55,30 +59,14 @@ waitdisk(void)
     ;
 }
 
-// Read a single sector at offset into dst.
-void
-readsect(void *dst, uint offset)
-{
-  // Issue command.
-  waitdisk();
-  outb(0x1F2, 1);   // count = 1
-  outb(0x1F3, offset);
-  outb(0x1F4, offset >> 8);
-  outb(0x1F5, offset >> 16);
-  outb(0x1F6, (offset >> 24) | 0xE0);
-  outb(0x1F7, 0x20);  // cmd 0x20 - read sectors
-
-  // Read data.
-  waitdisk();
-  insl(0x1F0, dst, SECTSIZE/4);
-}
-
 // Read 'count' bytes at 'offset' from kernel into physical address 'pa'.
-// Might copy more than asked.
-void
+// Might copy more than asked.  Skips the first sector if the previous
+// call read that same disk sector last, to the same place.
+static void
 readseg(uchar* pa, uint count, uint offset)
 {
   uchar* epa;
+  uint n;
 
   epa = pa + count;
 
@@ -88,9 +76,37 @@ readseg(uchar* pa, uint count, uint offset)
   // Translate from bytes to sectors; kernel starts at sector 1.
   offset = (offset / SECTSIZE) + 1;
 
-  // If this is too slow, we could read lots of sectors at a time.
-  // We'd write more to memory than asked, but it doesn't matter --
-  // we load in increasing order.
-  for(; pa < epa; pa += SECTSIZE, offset++)
-    readsect(pa, offset);
+  // Adjacent segments sharing a sector.
+  if(pa + SECTSIZE == lastpa && offset + 1 == lastsect){
+    pa = lastpa;
+    offset = lastsect;
+  }
+
+  // Read up to 256 sectors per command.  We'd write more to
+  // memory than asked, but it doesn't matter -- we load in
+  // increasing order.
+  while(pa < epa){
+    n = (epa - pa + SECTSIZE - 1) / SECTSIZE;
+    if(n > 256)
+      n = 256;
+
+    // Issue command; a count of 256 is sent as 0.
+    waitdisk();
+    outb(0x1F2, n);
+    outb(0x1F3, offset);
+    outb(0x1F4, offset >> 8);
+    outb(0x1F5, offset >> 16);
+    outb(0x1F6, (offset >> 24) | 0xE0);
+    outb(0x1F7, 0x20);  // cmd 0x20 - read sectors
+
+    // Read data; the disk is busy again between sectors.
+    offset += n;
+    do{
+      waitdisk();
+      insl(0x1F0, pa, SECTSIZE/4);
+      pa += SECTSIZE;
+    }while(--n > 0);
+  }
+  lastpa = pa;
+  lastsect = offset;
 }
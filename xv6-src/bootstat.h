@@ -0,0 +1,15 @@
+// Boot timing, returned by getbootstat().  Times are in units
+// of 1024 TSC cycles since the boot CPU entered main().  Include
+// param.h first, for NCPU.
+#define BOOT_KINIT1      0  // first 4MB of memory to the allocator
+#define BOOT_DEVICES     1  // page tables, interrupts, devices, caches
+#define BOOT_STARTOTHERS 2  // STARTUP sent to the other CPUs
+#define BOOT_KINIT2      3  // rest of memory to the allocator
+#define BOOT_USERINIT    4  // first process created
+#define NBOOTPHASE       5
+
+struct bootstat {
+  uint ncpu;
+  uint phase[NBOOTPHASE];  // end of each phase of main()
+  uint cpu[NCPU];          // when each CPU entered the scheduler
+};
@@ -0,0 +1,8 @@
+// Copy-on-write fork statistics, returned by getcowstat().
+struct cowstat {
+  uint faults;  // CoW faults taken
+  uint copies;  // faults that copied a page still shared
+  uint eager;   // pages copied eagerly at fork
+  uint saved;   // eager copies written afterwards: faults avoided
+  uint wasted;  // eager copies never written
+};
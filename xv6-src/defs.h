@@ -1,14 +1,24 @@
+struct bootstat;
 struct buf;
 struct context;
+struct cowstat;
 struct file;
 struct inode;
+struct ktimer;
+struct lockstat;
 struct pipe;
 struct proc;
 struct rtcdate;
+struct rusage;
+struct rwlock;
+struct schedstat;
+struct seqlock;
 struct spinlock;
 struct sleeplock;
+struct trapframe;
 struct stat;
 struct superblock;
+struct syscallstat;
 
 // bio.c
 void            binit(void);
@@ -53,6 +63,11 @@ int             readi(struct inode*, char*, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
 
+// futex.c
+void            futexinit(void);
+int             futexwait(uint, uint);
+int             futexwake(uint, int);
+
 // ide.c
 void            ideinit(void);
 void            ideintr(void);
@@ -66,6 +81,8 @@ void            ioapicinit(void);
 // kalloc.c
 char*           kalloc(void);
 void            kfree(char*);
+int             kalloc_bulk(int, char**);
+void            kfree_bulk(char**, int);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
 int             getNumFreePages(void);
@@ -76,6 +93,16 @@ int             get_ref(char *pa);
 // kbd.c
 void            kbdintr(void);
 
+// ktimer.c
+void            ktimerinit(void);
+void            ktimerset(struct ktimer*, uint);
+int             ktimercancel(struct ktimer*);
+void            ktimertick(uint);
+
+// ktrace.c
+void            trace(int, uint, uint, uint, uint);
+void            traceinit(void);
+
 // lapic.c
 void            cmostime(struct rtcdate *r);
 int             lapicid(void);
@@ -85,12 +112,22 @@ void            lapicinit(void);
 void            lapicstartap(uchar, uint);
 void            microdelay(int);
 
+// lockclass.c
+int             getlockstat(struct lockstat*, int);
+int             lockclass(char*, int);
+void            lockcount(int, int, uint64);
+void            lockhold(int, uint64);
+void            resetlockstat(void);
+
 // log.c
 void            initlog(int dev);
 void            log_write(struct buf*);
 void            begin_op();
 void            end_op();
 
+// main.c
+void            getbootstat(struct bootstat*);
+
 // mp.c
 extern int      ismp;
 void            mpinit(void);
@@ -107,33 +144,72 @@ int             pipewrite(struct pipe*, char*, int);
 
 //PAGEBREAK: 16
 // proc.c
+int             clone(uint, uint, uint);
 int             cpuid(void);
 void            exit(void);
+struct cpu*     findcpu(void);
 int             fork(void);
+int             getrusage(int, struct rusage*);
+int             getschedstat(int, struct schedstat*);
 int             growproc(int);
+int             join(uint*);
 int             kill(int);
 struct cpu*     mycpu(void);
 struct proc*    myproc();
 void            pinit(void);
 void            procdump(void);
+pde_t*          putvm(struct proc*);
 void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
+void            schedboost(void);
+int             schedtick(void);
 void            setproc(struct proc*);
+int             setchildfirst(int);
+int             setpriority(int, int);
 void            sleep(void*, struct spinlock*);
+int             spawn(int, uint);
+void            untimeout(void);
 void            userinit(void);
+void            vmlock(struct proc*);
+int             vmshared(struct proc*);
+void            vmsync(struct proc*);
+void            vmunlock(struct proc*);
 int             wait(void);
+int             wait2(struct rusage*);
 void            wakeup(void*);
+void            wakeupone(void*);
+int             wakeupn(void*, int);
+void            wakeproc(struct proc*);
 void            yield(void);
+int             zygote(void);
+
+// profile.c
+void            profinit(void);
+int             profread(uint, int);
+int             profstart(int);
+int             profstop(void);
+void            proftick(struct trapframe*);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
 
 // spinlock.c
 void            acquire(struct spinlock*);
+void            acquireread(struct rwlock*);
+void            acquirewrite(struct rwlock*);
 void            getcallerpcs(void*, uint*);
 int             holding(struct spinlock*);
 void            initlock(struct spinlock*, char*);
+void            initmcslock(struct spinlock*, char*);
+void            initrwlock(struct rwlock*, char*);
+void            initseqlock(struct seqlock*);
+uint            readseqbegin(struct seqlock*);
+int             readseqretry(struct seqlock*, uint);
 void            release(struct spinlock*);
+void            releaseread(struct rwlock*);
+void            releasewrite(struct rwlock*);
+void            writeseqbegin(struct seqlock*);
+void            writeseqend(struct seqlock*);
 void            pushcli(void);
 void            popcli(void);
 
@@ -159,6 +235,13 @@ int             argstr(int, char**);
 int             fetchint(uint, int*);
 int             fetchstr(uint, char**);
 void            syscall(void);
+int             syscallstat(struct syscallstat*, int);
+
+// textcache.c
+int             textcached(struct inode*);
+void            textinit(void);
+void            textinval(struct inode*);
+char*           textpage(struct inode*, uint, uint);
 
 // timer.c
 void            timerinit(void);
@@ -168,6 +251,7 @@ void            idtinit(void);
 extern uint     ticks;
 void            tvinit(void);
 extern struct spinlock tickslock;
+extern struct seqlock tickseq;
 
 // uart.c
 void            uartinit(void);
@@ -182,21 +266,28 @@ char*           uva2ka(pde_t*, char*);
 int             allocuvm(pde_t*, uint, uint);
 int             deallocuvm(pde_t*, uint, uint);
 void            freevm(pde_t*);
+int             freevmlater(pde_t*);
+int             reapvm(int);
 void            inituvm(pde_t*, char*, uint);
 int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
-pde_t*          copyuvm(pde_t*, uint);
+int             loadseg(pde_t*, uint, char*, struct inode*, uint, uint, uint);
+pde_t*          copyuvm(pde_t*, uint, uint, int);
+pde_t*          cloneuvm(pde_t*, uint, uint);
+void            wrprotectuvm(pde_t*, uint, uint);
+int             unshareuvm(pde_t*, uint, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
-void            clearpteu(pde_t *pgdir, char *uva);
 int             count_virtual_pages(void); 
 int             count_physical_pages(void);
 int             count_page_table_pages(void);
+int             growstack(struct proc*, uint);
 int             handle_page_fault(void);
 int             mappageshared(void);
 int             findsharedva(void);
 int             unmapsharedpage(void);
 int             handle_cow_fault(void);
+void            getcowstat(struct cowstat*);
 
 
 // number of elements in fixed-size array
@@ -49,24 +49,24 @@ exec(char *path, char **argv)
       goto bad;
     if(ph.vaddr + ph.memsz < ph.vaddr)
       goto bad;
-    if((sz = allocuvm(pgdir, sz, ph.vaddr + ph.memsz)) == 0)
-      goto bad;
     if(ph.vaddr % PGSIZE != 0)
       goto bad;
-    if(loaduvm(pgdir, (char*)ph.vaddr, ip, ph.off, ph.filesz) < 0)
+    if((sz = loadseg(pgdir, sz, (char*)ph.vaddr, ip, ph.off,
+                     ph.filesz, ph.memsz)) == 0)
       goto bad;
   }
   iunlockput(ip);
   end_op();
   ip = 0;
 
-  // Allocate two pages at the next page boundary.
-  // Make the first inaccessible.  Use the second as the user stack.
+  // Map the top page of the stack reserve; the stack grows
+  // down from there on demand (see growstack).
   sz = PGROUNDUP(sz);
-  if((sz = allocuvm(pgdir, sz, sz + 2*PGSIZE)) == 0)
+  if(sz > USTACKBASE)
+    goto bad;
+  if(allocuvm(pgdir, USTACKTOP - PGSIZE, USTACKTOP) == 0)
     goto bad;
-  clearpteu(pgdir, (char*)(sz - 2*PGSIZE));
-  sp = sz;
+  sp = USTACKTOP;
 
   // Push argument strings, prepare rest of stack in ustack.
   for(argc = 0; argv[argc]; argc++) {
@@ -93,14 +93,16 @@ exec(char *path, char **argv)
       last = s+1;
   safestrcpy(curproc->name, last, sizeof(curproc->name));
 
-  // Commit to the user image.
-  oldpgdir = curproc->pgdir;
+  // Commit to the user image, leaving any threads the old one.
+  oldpgdir = putvm(curproc);
   curproc->pgdir = pgdir;
   curproc->sz = sz;
+  curproc->stack = USTACKTOP - PGSIZE;
   curproc->tf->eip = elf.entry;  // main
   curproc->tf->esp = sp;
   switchuvm(curproc);
-  freevm(oldpgdir);
+  if(oldpgdir)
+    freevm(oldpgdir);
   return 0;
 
  bad:
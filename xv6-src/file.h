@@ -16,6 +16,7 @@ struct inode {
   int ref;            // Reference count
   struct sleeplock lock; // protects everything below here
   int valid;          // inode has been read from disk?
+  int flags;          // I_TEXT
 
   short type;         // copy of disk inode
   short major;
@@ -34,4 +35,6 @@ struct devsw {
 
 extern struct devsw devsw[];
 
+#define I_TEXT 0x1  // the text cache may hold pages of the inode
+
 #define CONSOLE 1
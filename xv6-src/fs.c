@@ -266,6 +266,7 @@ iget(uint dev, uint inum)
   ip->inum = inum;
   ip->ref = 1;
   ip->valid = 0;
+  ip->flags = 0;
   release(&icache.lock);
 
   return ip;
@@ -308,6 +309,9 @@ ilock(struct inode *ip)
     ip->valid = 1;
     if(ip->type == 0)
       panic("ilock: no type");
+    // Pages cached before the inode left the inode cache.
+    if(textcached(ip))
+      ip->flags |= I_TEXT;
   }
 }
 
@@ -432,6 +436,7 @@ itrunc(struct inode *ip)
 
   ip->size = 0;
   iupdate(ip);
+  textinval(ip);
 }
 
 // Copy stat information from inode.
@@ -495,6 +500,7 @@ writei(struct inode *ip, char *src, uint off, uint n)
   if(off + n > MAXFILE*BSIZE)
     return -1;
 
+  textinval(ip);
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
@@ -0,0 +1,81 @@
+// Futexes: block until a word of user memory changes.
+//
+// futexwait(addr, val) sleeps if the word at addr still holds val,
+// and futexwake(addr, n) wakes up to n processes sleeping on addr.
+// A waiter sleeps on the kernel address of the word, that is on its
+// physical page and offset, so processes mapping the same page --
+// threads, or a mapshared() page after fork -- meet on the same
+// chan whatever their virtual addresses.
+//
+// futexlock is held from the check of the word until sleep() has
+// queued the waiter, and by wakers, so a wake that follows a store
+// to the word can't slip in between the check and the sleep.
+//
+// Lock order: futexlock, then ptable.lock.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+static struct spinlock futexlock;
+
+void
+futexinit(void)
+{
+  initlock(&futexlock, "futex");
+}
+
+// Return the kernel address of the aligned user word at addr,
+// or 0 if it is not mapped.
+static uint*
+futexword(uint addr)
+{
+  struct proc *curproc = myproc();
+  char *page;
+
+  if(addr % 4 != 0 || addr >= KERNBASE ||
+     (addr >= curproc->sz && addr < curproc->stack))
+    return 0;
+  if((page = uva2ka(curproc->pgdir, (char*)addr)) == 0)
+    return 0;
+  return (uint*)(page + addr % PGSIZE);
+}
+
+// Sleep until woken by futexwake(addr), unless the word at addr
+// no longer holds val.  Returns 0, or -1 if addr is bad; callers
+// must recheck the word, as it may have changed again.
+int
+futexwait(uint addr, uint val)
+{
+  uint *w;
+
+  if((w = futexword(addr)) == 0)
+    return -1;
+  acquire(&futexlock);
+  if(*w == val && !myproc()->killed)
+    sleep(w, &futexlock);
+  release(&futexlock);
+  return 0;
+}
+
+// Wake up to n processes waiting on addr, longest waiting first.
+// Returns the number woken, or -1 if addr is bad.
+int
+futexwake(uint addr, int n)
+{
+  uint *w;
+  int woken;
+
+  if((w = futexword(addr)) == 0)
+    return -1;
+  if(n <= 0)
+    return 0;
+  acquire(&futexlock);
+  woken = wakeupn(w, n);
+  release(&futexlock);
+  return woken;
+}
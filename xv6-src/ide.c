@@ -12,6 +12,7 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
+#include "trace.h"
 
 #define SECTOR_SIZE   512
 #define IDE_BSY       0x80
@@ -138,6 +139,8 @@ void
 iderw(struct buf *b)
 {
   struct buf **pp;
+  int write;
+  uint64 t0;
 
   if(!holdingsleep(&b->lock))
     panic("iderw: buf not locked");
@@ -146,6 +149,8 @@ iderw(struct buf *b)
   if(b->dev != 0 && !havedisk1)
     panic("iderw: ide disk 1 not present");
 
+  write = (b->flags & B_DIRTY) != 0;
+  t0 = rdtsc();
   acquire(&idelock);  //DOC:acquire-lock
 
   // Append b to idequeue.
@@ -165,4 +170,5 @@ iderw(struct buf *b)
 
 
   release(&idelock);
+  trace(TR_DISK, b->blockno, write, rdtsc() - t0, 0);
 }
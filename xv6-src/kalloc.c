@@ -22,34 +22,81 @@ struct {
   int use_lock;
   struct run *freelist;
   uint numfree; // Our new free page counter
+  char *lazy;     // pages in [lazy, lazyend) have never been handed out
+  char *lazyend;
 } kmem;
 
 static uint pa_to_index(char *pa); // <-- ADD THIS LINE
 static uint pg_ref_count[(PHYSTOP / PGSIZE)];
-static struct spinlock ref_lock;
+static struct rwlock ref_lock;  // readers: get_ref()
+static void lazyrange(void *vstart, void *vend);
 
 // Initialization happens in two phases.
 // 1. main() calls kinit1() while still using entrypgdir to place just
 // the pages mapped by entrypgdir on free list.
 // 2. main() calls kinit2() with the rest of the physical pages
 // after installing a full page table that maps them on all cores.
+// Neither touches the pages: they are kept as an untouched range that
+// kalloc() carves from once the free list runs dry (see lazyrange).
 void
 kinit1(void *vstart, void *vend)
 {
-  initlock(&kmem.lock, "kmem");
-  initlock(&ref_lock, "ref_lock");
+  initmcslock(&kmem.lock, "kmem");
+  initrwlock(&ref_lock, "ref_lock");
   kmem.use_lock = 0;
   kmem.numfree = 0; 
-  freerange(vstart, vend);
+  lazyrange(vstart, vend);
 }
 
 void
 kinit2(void *vstart, void *vend)
 {
-  freerange(vstart, vend);
+  lazyrange(vstart, vend);
   kmem.use_lock = 1;
 }
 
+// Give the pages in [vstart, vend) to the allocator without
+// writing to them, so boot time does not grow with RAM size.
+// A range that does not adjoin the current one is freed a page
+// at a time instead.
+static void
+lazyrange(void *vstart, void *vend)
+{
+  char *p;
+  uint n;
+
+  p = (char*)PGROUNDUP((uint)vstart);
+  if(p >= (char*)vend)
+    return;
+  if(kmem.lazy == kmem.lazyend)
+    kmem.lazy = kmem.lazyend = p;
+  if(p != kmem.lazyend){
+    freerange(vstart, vend);
+    return;
+  }
+  n = ((char*)vend - p) / PGSIZE;
+  kmem.numfree += n;
+  kmem.lazyend = p + n*PGSIZE;
+}
+
+// Take a page off the free list, or failing that off the
+// untouched range.  Caller must hold kmem.lock.
+static struct run*
+takepage(void)
+{
+  struct run *r;
+
+  if((r = kmem.freelist) != 0)
+    kmem.freelist = r->next;
+  else if(kmem.lazy < kmem.lazyend){
+    r = (struct run*)kmem.lazy;
+    kmem.lazy += PGSIZE;
+  }
+  if(r)
+    kmem.numfree--;
+  return r;
+}
+
 void
 freerange(void *vstart, void *vend)
 {
@@ -106,26 +153,110 @@ kalloc(void)
 {
   struct run *r;
 
+again:
   if(kmem.use_lock)
     acquire(&kmem.lock);
 
-  r = kmem.freelist;
-  if(r){
-    kmem.freelist = r->next;
-    kmem.numfree--;
-  }
+  r = takepage();
 
   if(kmem.use_lock)
     release(&kmem.lock);
 
+  // Out of memory: free the address spaces still waiting
+  // for an idle CPU (see freevmlater) and try again.
+  if(r == 0 && kmem.use_lock && reapvm(-1) > 0)
+    goto again;
+
   if(r && kmem.use_lock){
-    acquire(&ref_lock);
+    acquirewrite(&ref_lock);
     pg_ref_count[pa_to_index((char*)r)] = 1;
-    release(&ref_lock);
+    releasewrite(&ref_lock);
   }
 
   return (char*)r;
 }
+
+// Allocate up to n pages into out[], taking kmem.lock and
+// ref_lock once for the whole batch rather than once per page.
+// Returns the number of pages allocated, fewer than n only if
+// memory ran out.
+int
+kalloc_bulk(int n, char **out)
+{
+  struct run *r;
+  int i, got;
+
+  got = 0;
+again:
+  if(kmem.use_lock)
+    acquire(&kmem.lock);
+  for(i = got; i < n && (r = takepage()) != 0; i++)
+    out[i] = (char*)r;
+  got = i;
+  if(kmem.use_lock)
+    release(&kmem.lock);
+
+  if(got < n && kmem.use_lock && reapvm(-1) > 0)
+    goto again;
+
+  if(got > 0 && kmem.use_lock){
+    acquirewrite(&ref_lock);
+    for(i = 0; i < got; i++)
+      pg_ref_count[pa_to_index(out[i])] = 1;
+    releasewrite(&ref_lock);
+  }
+  return got;
+}
+
+// Drop a reference to each of the n pages in v[], as kfree() does,
+// and splice those that are no longer used onto the free list in one
+// go.  Entries of v[] that still had other references are zeroed.
+void
+kfree_bulk(char **v, int n)
+{
+  struct run *r, *head, *tail;
+  int i, nfree;
+
+  for(i = 0; i < n; i++)
+    if((uint)v[i] % PGSIZE || v[i] < end || V2P(v[i]) >= PHYSTOP)
+      panic("kfree_bulk");
+
+  if(kmem.use_lock){
+    acquirewrite(&ref_lock);
+    for(i = 0; i < n; i++){
+      uint *ref = &pg_ref_count[pa_to_index(v[i])];
+      if(*ref == 0)
+        panic("kfree_bulk: ref count 0 or less");
+      if(--*ref > 0)
+        v[i] = 0;
+    }
+    releasewrite(&ref_lock);
+  }
+
+  head = tail = 0;
+  nfree = 0;
+  for(i = 0; i < n; i++){
+    if(v[i] == 0)
+      continue;
+    memset(v[i], 1, PGSIZE);
+    r = (struct run*)v[i];
+    r->next = head;
+    if(tail == 0)
+      tail = r;
+    head = r;
+    nfree++;
+  }
+  if(head == 0)
+    return;
+
+  if(kmem.use_lock)
+    acquire(&kmem.lock);
+  tail->next = kmem.freelist;
+  kmem.freelist = head;
+  kmem.numfree += nfree;
+  if(kmem.use_lock)
+    release(&kmem.lock);
+}
 int
 getNumFreePages(void)
 {
@@ -147,18 +278,18 @@ pa_to_index(char *pa)
 void
 inc_ref(char *pa)
 {
-  acquire(&ref_lock);
+  acquirewrite(&ref_lock);
   pg_ref_count[pa_to_index(pa)]++;
-  release(&ref_lock);
+  releasewrite(&ref_lock);
 }
 
 // Decrement the reference count for a page
 void
 dec_ref(char *pa)
 {
-  acquire(&ref_lock);
+  acquirewrite(&ref_lock);
   pg_ref_count[pa_to_index(pa)]--;
-  release(&ref_lock);
+  releasewrite(&ref_lock);
 }
 
 // Get the reference count for a page
@@ -166,8 +297,8 @@ int
 get_ref(char *pa)
 {
   int count;
-  acquire(&ref_lock);
+  acquireread(&ref_lock);
   count = pg_ref_count[pa_to_index(pa)];
-  release(&ref_lock);
+  releaseread(&ref_lock);
   return count;
 }
\ No newline at end of file
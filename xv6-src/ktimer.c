@@ -0,0 +1,93 @@
+// Kernel timers.
+//
+// sys_sleep() used to sleep on &ticks, which the timer interrupt
+// woke 100 times a second: every sleeper woke, rechecked its
+// deadline and went back to sleep.  Instead a sleeper now arms a
+// ktimer, which sits on a timer wheel: NWHEEL slots indexed by the
+// tick it expires at.  Each tick looks only at its own slot and wakes
+// just the timers that expire then; timers further away than NWHEEL
+// ticks stay in the slot for later rounds.
+//
+// A timer wakes its process from whatever it sleeps on (wakeproc),
+// so any blocking call can use one as a timeout: arm the timer, then
+// loop sleeping until the condition holds or t->fired is set.
+//
+// Lock order: tickslock, then wheel.lock, then ptable.lock.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "spinlock.h"
+#include "ktimer.h"
+
+#define NWHEEL 256
+
+struct {
+  struct spinlock lock;
+  uint now;                      // last tick processed
+  struct ktimer *slot[NWHEEL];
+} wheel;
+
+void
+ktimerinit(void)
+{
+  initlock(&wheel.lock, "ktimer");
+}
+
+// Arm t to wake the current process n ticks from now
+// (at least one).
+void
+ktimerset(struct ktimer *t, uint n)
+{
+  struct ktimer **pp;
+
+  acquire(&wheel.lock);
+  t->proc = myproc();
+  t->expires = wheel.now + (n > 0 ? n : 1);
+  t->fired = 0;
+  pp = &wheel.slot[t->expires % NWHEEL];
+  t->next = *pp;
+  *pp = t;
+  release(&wheel.lock);
+}
+
+// Disarm t if it has not fired yet.
+// Returns whether it had fired.
+int
+ktimercancel(struct ktimer *t)
+{
+  struct ktimer **pp;
+  int fired;
+
+  acquire(&wheel.lock);
+  fired = t->fired;
+  if(!fired){
+    for(pp = &wheel.slot[t->expires % NWHEEL]; *pp != t; pp = &(*pp)->next)
+      ;
+    *pp = t->next;
+  }
+  release(&wheel.lock);
+  return fired;
+}
+
+// Fire the timers that expire at tick now.
+// Called by the timer interrupt on every tick.
+void
+ktimertick(uint now)
+{
+  struct ktimer **pp, *t;
+
+  acquire(&wheel.lock);
+  wheel.now = now;
+  pp = &wheel.slot[now % NWHEEL];
+  while((t = *pp) != 0){
+    if(t->expires != now){
+      pp = &t->next;  // a later round
+      continue;
+    }
+    *pp = t->next;
+    t->fired = 1;
+    wakeproc(t->proc);
+  }
+  release(&wheel.lock);
+}
@@ -0,0 +1,7 @@
+// Kernel timer: wakes a process a given number of ticks from now.
+struct ktimer {
+  struct ktimer *next;  // next in its timer wheel slot
+  uint expires;         // tick at which it fires
+  struct proc *proc;    // process to wake
+  int fired;
+};
@@ -0,0 +1,144 @@
+// Kernel event tracing.
+//
+// Tracepoints in the kernel call trace() to record a fixed-size event
+// stamped with the TSC, CPU and pid.  While tracing is on, each CPU
+// appends to its own ring with interrupts off, taking no lock: only
+// that CPU moves the ring's head, and only the reader moves its tail,
+// under tbuf.lock.  An event that finds its ring full is counted in
+// the ring's lost count, which the reader reports as a TR_LOST event.
+//
+// Tracing is driven through /trace (major TRACE):
+// * writing '1' empties the rings and starts tracing, '0' stops it;
+// * reading drains whole events, oldest first within each CPU.
+// A CPU already past the check of tbuf.on when tracing is restarted
+// can still store one event into the emptied rings.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "trace.h"
+
+struct tracering {
+  struct traceev ev[NTRACE];
+  volatile uint head;   // next slot to fill, by this CPU
+  volatile uint tail;   // next slot to drain, by the reader
+  volatile uint lost;
+} __attribute__((aligned(64)));
+
+static struct {
+  struct spinlock lock;
+  volatile int on;
+  struct tracering ring[NCPU];
+} tbuf;
+
+// Record an event of type with arguments a0..a3.
+void
+trace(int type, uint a0, uint a1, uint a2, uint a3)
+{
+  struct tracering *r;
+  struct traceev *e;
+  struct proc *p;
+
+  if(!tbuf.on)
+    return;
+  pushcli();
+  r = &tbuf.ring[cpuid()];
+  if(r->head - r->tail == NTRACE){
+    __sync_fetch_and_add(&r->lost, 1);
+    popcli();
+    return;
+  }
+  e = &r->ev[r->head % NTRACE];
+  p = myproc();
+  e->tsc = rdtsc();
+  e->type = type;
+  e->cpu = cpuid();
+  e->pid = p ? p->pid : 0;
+  e->arg[0] = a0;
+  e->arg[1] = a1;
+  e->arg[2] = a2;
+  e->arg[3] = a3;
+  __sync_synchronize();  // event before head
+  r->head++;
+  popcli();
+}
+
+// Move up to n bytes of whole events to dst.
+static int
+traceread(struct inode *ip, char *dst, int n)
+{
+  struct traceev chunk[16];
+  struct tracering *r;
+  int k, max, tot;
+
+  n -= n % sizeof(chunk[0]);
+  for(tot = 0; tot < n; tot += k*sizeof(chunk[0])){
+    max = NELEM(chunk);
+    if(max > (n - tot) / sizeof(chunk[0]))
+      max = (n - tot) / sizeof(chunk[0]);
+    k = 0;
+    acquire(&tbuf.lock);
+    for(r = tbuf.ring; r < &tbuf.ring[ncpu] && k < max; r++){
+      if(r->lost){
+        memset(&chunk[k], 0, sizeof(chunk[k]));
+        chunk[k].type = TR_LOST;
+        chunk[k].cpu = r - tbuf.ring;
+        chunk[k].arg[0] = xchg(&r->lost, 0);
+        k++;
+      }
+      while(r->tail != r->head && k < max){
+        __sync_synchronize();  // head before event
+        chunk[k++] = r->ev[r->tail % NTRACE];
+        r->tail++;
+      }
+    }
+    release(&tbuf.lock);
+    if(k == 0)
+      break;
+    // dst is a user address; copy without tbuf.lock.
+    memmove(dst + tot, chunk, k*sizeof(chunk[0]));
+  }
+  return tot;
+}
+
+// '1' starts tracing into emptied rings, '0' stops it.
+static int
+tracewrite(struct inode *ip, char *src, int n)
+{
+  struct tracering *r;
+  char c;
+
+  if(n < 1)
+    return n;
+  c = src[0];  // may fault; read before taking tbuf.lock
+  if(c != '0' && c != '1')
+    return -1;
+  acquire(&tbuf.lock);
+  tbuf.on = 0;
+  if(c == '1'){
+    __sync_synchronize();
+    for(r = tbuf.ring; r < &tbuf.ring[NCPU]; r++){
+      r->head = r->tail = 0;
+      r->lost = 0;
+    }
+    __sync_synchronize();
+    tbuf.on = 1;
+  }
+  release(&tbuf.lock);
+  return n;
+}
+
+void
+traceinit(void)
+{
+  initlock(&tbuf.lock, "trace");
+  devsw[TRACE].read = traceread;
+  devsw[TRACE].write = tracewrite;
+}
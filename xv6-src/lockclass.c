@@ -0,0 +1,126 @@
+// Lock contention statistics.
+//
+// Locks are counted per class: every lock initialized with the same
+// name and kind, so the 50 inode sleep locks or all pipe locks add
+// up to one line.  A lock looks up its class on first use and keeps
+// the index; the table only grows, so a lock initialized again (a
+// pipe's, say) finds its old class.
+//
+// The counters are per CPU and are only updated with interrupts off
+// (in acquire()/release(), or under a sleep lock's spin lock), so
+// they need no lock.  getlockstat() adds up the CPUs' counters.
+// resetlockstat() zeroes them without stopping the other CPUs, so
+// counts racing with it may survive.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "x86.h"
+#include "mmu.h"
+#include "proc.h"
+#include "lockstat.h"
+
+struct lockcount {
+  uint acquires;
+  uint contended;
+  uint64 wait;
+  uint64 maxhold;
+};
+
+static struct {
+  volatile uint busy;            // guards adding classes
+  int n;
+  char *name[NLOCKCLASS];
+  int sleep[NLOCKCLASS];
+} classes;
+
+static struct lockcount counts[NCPU][NLOCKCLASS];
+
+// Return the class number (from 1) of locks called name, adding
+// it if it is new.  Returns -1 if the table is full.  Interrupts must be off, as a
+// plain spin lock (which would be counted) can't be used here.
+int
+lockclass(char *name, int sleep)
+{
+  int i;
+
+  while(xchg(&classes.busy, 1) != 0)
+    pause();
+  for(i = 0; i < classes.n; i++)
+    if(classes.sleep[i] == sleep && strncmp(classes.name[i], name, 16) == 0)
+      break;
+  if(i == classes.n){
+    if(i == NLOCKCLASS)
+      i = -1;
+    else {
+      classes.name[i] = name;
+      classes.sleep[i] = sleep;
+      classes.n++;
+    }
+  }
+  xchg(&classes.busy, 0);
+  return i < 0 ? -1 : i + 1;
+}
+
+// Count an acquisition of a lock of class cls that waited wait
+// cycles, if contended.  Interrupts must be off.
+void
+lockcount(int cls, int contended, uint64 wait)
+{
+  struct lockcount *lc;
+
+  if(cls <= 0)
+    return;
+  lc = &counts[cpuid()][cls-1];
+  lc->acquires++;
+  if(contended){
+    lc->contended++;
+    lc->wait += wait;
+  }
+}
+
+// Count a release after holding a lock of class cls for hold
+// cycles.  Interrupts must be off.
+void
+lockhold(int cls, uint64 hold)
+{
+  struct lockcount *lc;
+
+  if(cls <= 0)
+    return;
+  lc = &counts[cpuid()][cls-1];
+  if(hold > lc->maxhold)
+    lc->maxhold = hold;
+}
+
+// Copy the statistics of up to n classes to st, which may be a user
+// address: no lock is held.  Returns the number copied.
+int
+getlockstat(struct lockstat *st, int n)
+{
+  struct lockstat s;
+  struct lockcount *lc;
+  int i, c;
+
+  for(i = 0; i < classes.n && i < n; i++){
+    memset(&s, 0, sizeof(s));
+    safestrcpy(s.name, classes.name[i], sizeof(s.name));
+    s.sleep = classes.sleep[i];
+    for(c = 0; c < ncpu; c++){
+      lc = &counts[c][i];
+      s.acquires += lc->acquires;
+      s.contended += lc->contended;
+      s.wait += lc->wait;
+      if(lc->maxhold > s.maxhold)
+        s.maxhold = lc->maxhold;
+    }
+    st[i] = s;
+  }
+  return i;
+}
+
+void
+resetlockstat(void)
+{
+  memset(counts, 0, sizeof(counts));
+}
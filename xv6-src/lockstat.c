@@ -0,0 +1,67 @@
+// Print the most contended kernel locks.
+//   lockstat            show the counters since boot or the last reset
+//   lockstat -r         reset the counters
+//   lockstat cmd args   reset, run cmd, then show the counters
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "lockstat.h"
+
+#define NTOP 10
+
+struct lockstat st[NLOCKCLASS];
+
+void
+show(void)
+{
+  int i, j, n;
+  struct lockstat t;
+
+  n = getlockstat(st, NLOCKCLASS);
+
+  // Most cycles spent waiting first.
+  for(i = 0; i < n; i++)
+    for(j = i+1; j < n; j++)
+      if(st[j].wait > st[i].wait){
+        t = st[i];
+        st[i] = st[j];
+        st[j] = t;
+      }
+
+  printf(1, "%s\t%s\t%s\t%s\t%s\t%s\n", "lock", "kind", "acquires",
+         "contended", "wait(Kc)", "maxhold(Kc)");
+  for(i = 0; i < n && i < NTOP; i++)
+    printf(1, "%s\t%s\t%d\t%d\t%d\t%d\n", st[i].name,
+           st[i].sleep ? "sleep" : "spin", st[i].acquires, st[i].contended,
+           (uint)(st[i].wait >> 10), (uint)(st[i].maxhold >> 10));
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(argc > 1 && strcmp(argv[1], "-r") == 0){
+    resetlockstat();
+    exit();
+  }
+
+  if(argc > 1){
+    resetlockstat();
+    pid = fork();
+    if(pid < 0){
+      printf(2, "lockstat: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      exec(argv[1], argv+1);
+      printf(2, "lockstat: exec %s failed\n", argv[1]);
+      exit();
+    }
+    wait();
+  }
+
+  show();
+  exit();
+}
@@ -0,0 +1,12 @@
+#define NLOCKCLASS 64  // lock classes counted
+
+// Contention statistics of a lock class -- all the locks initialized
+// with the same name -- returned by getlockstat().
+struct lockstat {
+  char name[16];
+  int sleep;         // 1 for sleep locks
+  uint acquires;     // times acquired
+  uint contended;    // acquisitions that had to wait
+  uint64 wait;       // TSC cycles spent waiting: spinning, or asleep
+  uint64 maxhold;    // longest time held, in TSC cycles
+};
@@ -1,10 +1,14 @@
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "mmu.h"
+#include "proc.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "fs.h"
+#include "x86.h"
 #include "buf.h"
+#include "trace.h"
 
 // Simple logging that allows concurrent FS system calls.
 //
@@ -192,12 +196,18 @@ write_log(void)
 static void
 commit()
 {
+  int n;
+  uint64 t0;
+
   if (log.lh.n > 0) {
+    n = log.lh.n;
+    t0 = rdtsc();
     write_log();     // Write modified blocks from cache to log
     write_head();    // Write header to disk -- the real commit
     install_trans(); // Now install writes to home locations
     log.lh.n = 0;
     write_head();    // Erase the transaction from the log
+    trace(TR_COMMIT, n, rdtsc() - t0, 0, 0);
   }
 }
 
@@ -226,8 +236,13 @@ log_write(struct buf *b)
       break;
   }
   log.lh.block[i] = b->blockno;
-  if (i == log.lh.n)
+  if (i == log.lh.n) {
     log.lh.n++;
+    // Charge the block to the process that dirtied it, not to
+    // the one whose end_op() happens to commit it.
+    if (myproc())
+      myproc()->oublock++;
+  }
   b->flags |= B_DIRTY; // prevent eviction
   release(&log.lock);
 }
@@ -5,8 +5,11 @@
 #include "mmu.h"
 #include "proc.h"
 #include "x86.h"
+#include "bootstat.h"
 
 static void startothers(void);
+static void bootphase(int);
+static void bootreport(void);
 static void mpmain(void)  __attribute__((noreturn));
 extern pde_t *kpgdir;
 extern char end[]; // first address after kernel loaded from ELF file
@@ -17,7 +20,9 @@ extern char end[]; // first address after kernel loaded from ELF file
 int
 main(void)
 {
+  bootphase(-1);
   kinit1(end, P2V(4*1024*1024)); // phys page allocator
+  bootphase(BOOT_KINIT1);
   kvmalloc();      // kernel page table
   mpinit();        // detect other processors
   lapicinit();     // interrupt controller
@@ -25,18 +30,90 @@ main(void)
   picinit();       // disable pic
   ioapicinit();    // another interrupt controller
   consoleinit();   // console hardware
+  traceinit();     // /trace device
   uartinit();      // serial port
   pinit();         // process table
   tvinit();        // trap vectors
+  ktimerinit();    // sleep timers
+  futexinit();     // user-space wait channels
+  profinit();      // sampling profiler
   binit();         // buffer cache
+  textinit();      // shared program text
   fileinit();      // file table
   ideinit();       // disk 
-  startothers();   // start other processors
+  bootphase(BOOT_DEVICES);
+  startothers();   // start other processors; they come up while we go on
+  bootphase(BOOT_STARTOTHERS);
   kinit2(P2V(4*1024*1024), P2V(PHYSTOP)); // must come after startothers()
+  bootphase(BOOT_KINIT2);
   userinit();      // first user process
+  bootphase(BOOT_USERINIT);
+  bootreport();
   mpmain();        // finish this processor's setup
 }
 
+// Boot phase timestamps: the TSC when main() started and
+// at the end of each phase.  See getbootstat().
+static uint64 bootstart;
+static uint64 boottsc[NBOOTPHASE];
+
+static char *bootname[NBOOTPHASE] = {
+[BOOT_KINIT1]      "kinit1",
+[BOOT_DEVICES]     "devices",
+[BOOT_STARTOTHERS] "startothers",
+[BOOT_KINIT2]      "kinit2",
+[BOOT_USERINIT]    "userinit",
+};
+
+static void
+bootphase(int phase)
+{
+  if(phase < 0)
+    bootstart = rdtsc();
+  else
+    boottsc[phase] = rdtsc();
+}
+
+// Cycles from the start of main() to tsc, in units of 1024;
+// the kernel has no 64-bit division.
+static uint
+bootkcycles(uint64 tsc)
+{
+  if(tsc < bootstart)
+    return 0;
+  return (uint)((tsc - bootstart) >> 10);
+}
+
+// Print the cycles each phase took.
+static void
+bootreport(void)
+{
+  int i;
+  uint prev;
+
+  prev = 0;
+  for(i = 0; i < NBOOTPHASE; i++){
+    cprintf("boot: %s %d Kcycles\n", bootname[i],
+            bootkcycles(boottsc[i]) - prev);
+    prev = bootkcycles(boottsc[i]);
+  }
+  cprintf("boot: total %d Kcycles\n", prev);
+}
+
+// Copy the boot timestamps to st.  CPUs that have not
+// reached the scheduler yet read as 0.
+void
+getbootstat(struct bootstat *st)
+{
+  int i;
+
+  st->ncpu = ncpu;
+  for(i = 0; i < NBOOTPHASE; i++)
+    st->phase[i] = bootkcycles(boottsc[i]);
+  for(i = 0; i < NCPU; i++)
+    st->cpu[i] = i < ncpu && cpus[i].started ? bootkcycles(cpus[i].starttsc) : 0;
+}
+
 // Other CPUs jump here from entryother.S.
 static void
 mpenter(void)
@@ -53,6 +130,7 @@ mpmain(void)
 {
   cprintf("cpu%d: starting %d\n", cpuid(), cpuid());
   idtinit();       // load idt register
+  mycpu()->starttsc = rdtsc();
   xchg(&(mycpu()->started), 1); // tell startothers() we're up
   scheduler();     // start running processes
 }
@@ -64,9 +142,10 @@ static void
 startothers(void)
 {
   extern uchar _binary_entryother_start[], _binary_entryother_size[];
+  static char *stacks[NCPU];
   uchar *code;
   struct cpu *c;
-  char *stack;
+  int n;
 
   // Write entry code to unused memory at 0x7000.
   // The linker has placed the image of entryother.S in
@@ -74,23 +153,27 @@ startothers(void)
   code = P2V(0x7000);
   memmove(code, _binary_entryother_start, (uint)_binary_entryother_size);
 
-  for(c = cpus; c < cpus+ncpu; c++){
-    if(c == mycpu())  // We've started already.
-      continue;
+  // Allocate a stack for every AP up front: they come up at the
+  // same time and each takes the next one from the table.
+  n = 0;
+  for(c = cpus; c < cpus+ncpu; c++)
+    if(c != mycpu())  // We've started already.
+      stacks[n++] = kalloc() + KSTACKSIZE;
 
-    // Tell entryother.S what stack to use, where to enter, and what
-    // pgdir to use. We cannot use kpgdir yet, because the AP processor
-    // is running in low  memory, so we use entrypgdir for the APs too.
-    stack = kalloc();
-    *(void**)(code-4) = stack + KSTACKSIZE;
-    *(void(**)(void))(code-8) = mpenter;
-    *(int**)(code-12) = (void *) V2P(entrypgdir);
+  // Tell entryother.S where the stacks are, where to enter, and what
+  // pgdir to use. We cannot use kpgdir yet, because the AP processor
+  // is running in low  memory, so we use entrypgdir for the APs too.
+  *(char***)(code-4) = stacks;
+  *(void(**)(void))(code-8) = mpenter;
+  *(int**)(code-12) = (void *) V2P(entrypgdir);
+  *(uint*)(code-16) = 0;
 
+  // Don't wait for each AP to reach mpmain(); they finish their
+  // setup in parallel with each other and with the rest of main().
+  for(c = cpus; c < cpus+ncpu; c++){
+    if(c == mycpu())
+      continue;
     lapicstartap(c->apicid, V2P(code));
-
-    // wait for cpu to finish mpmain()
-    while(c->started == 0)
-      ;
   }
 }
 
@@ -8,6 +8,11 @@
 #define KERNBASE 0x80000000         // First kernel virtual address
 #define KERNLINK (KERNBASE+EXTMEM)  // Address where kernel is linked
 
+// The user stack grows down from USTACKTOP on demand, as far as
+// USTACKBASE; the heap (sz) stays below USTACKBASE.
+#define USTACKTOP  KERNBASE
+#define USTACKBASE (USTACKTOP - MAXUSTACK)
+
 #define V2P(a) (((uint) (a)) - KERNBASE)
 #define P2V(a) ((void *)(((char *) (a)) + KERNBASE))
 
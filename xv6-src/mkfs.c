@@ -40,6 +40,7 @@ void rinode(uint inum, struct dinode *ip);
 void rsect(uint sec, void *buf);
 uint ialloc(ushort type);
 void iappend(uint inum, void *p, int n);
+uint makedir(uint parent, char *name);
 
 // convert to intel byte order
 ushort
@@ -68,7 +69,8 @@ int
 main(int argc, char *argv[])
 {
   int i, cc, fd;
-  uint rootino, inum, off;
+  uint rootino, symino, dirino, inum, off;
+  char *p;
   struct dirent de;
   char buf[BSIZE];
   struct dinode din;
@@ -127,8 +129,10 @@ main(int argc, char *argv[])
   strcpy(de.name, "..");
   iappend(rootino, &de, sizeof(de));
 
+  symino = 0;
   for(i = 2; i < argc; i++){
     assert(index(argv[i], '/') == 0);
+    dirino = rootino;
 
     if((fd = open(argv[i], 0)) < 0){
       perror(argv[i]);
@@ -142,12 +146,20 @@ main(int argc, char *argv[])
     if(argv[i][0] == '_')
       ++argv[i];
 
+    // Symbol tables, cat.sym etc., go in /sym as /sym/cat.
+    if((p = strstr(argv[i], ".sym")) != 0 && p[4] == 0){
+      if(symino == 0)
+        symino = makedir(rootino, "sym");
+      *p = 0;
+      dirino = symino;
+    }
+
     inum = ialloc(T_FILE);
 
     bzero(&de, sizeof(de));
     de.inum = xshort(inum);
     strncpy(de.name, argv[i], DIRSIZ);
-    iappend(rootino, &de, sizeof(de));
+    iappend(dirino, &de, sizeof(de));
 
     while((cc = read(fd, buf, sizeof(buf))) > 0)
       iappend(inum, buf, cc);
@@ -162,6 +174,14 @@ main(int argc, char *argv[])
   din.size = xint(off);
   winode(rootino, &din);
 
+  if(symino != 0){
+    rinode(symino, &din);
+    off = xint(din.size);
+    off = ((off/BSIZE) + 1) * BSIZE;
+    din.size = xint(off);
+    winode(symino, &din);
+  }
+
   balloc(freeblock);
 
   exit(0);
@@ -234,6 +254,38 @@ ialloc(ushort type)
   return inum;
 }
 
+// Make directory name in parent and return its inode number.
+uint
+makedir(uint parent, char *name)
+{
+  uint inum;
+  struct dirent de;
+  struct dinode din;
+
+  inum = ialloc(T_DIR);
+
+  bzero(&de, sizeof(de));
+  de.inum = xshort(inum);
+  strcpy(de.name, ".");
+  iappend(inum, &de, sizeof(de));
+
+  bzero(&de, sizeof(de));
+  de.inum = xshort(parent);
+  strcpy(de.name, "..");
+  iappend(inum, &de, sizeof(de));
+
+  bzero(&de, sizeof(de));
+  de.inum = xshort(inum);
+  strncpy(de.name, name, DIRSIZ);
+  iappend(parent, &de, sizeof(de));
+
+  // The new ".." links to parent.
+  rinode(parent, &din);
+  din.nlink = xshort(xshort(din.nlink) + 1);
+  winode(parent, &din);
+  return inum;
+}
+
 void
 balloc(int used)
 {
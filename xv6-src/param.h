@@ -1,5 +1,6 @@
 #define NPROC        64  // maximum number of processes
 #define KSTACKSIZE 4096  // size of per-process kernel stack
+#define MAXUSTACK (1024*1024)  // address space reserved for a user stack
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
@@ -10,5 +11,10 @@
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define FSSIZE       4000  // size of file system in blocks
+#define NREAPBATCH    4  // address spaces an idle CPU frees at a time
+#define NPGBATCH     32  // pages per kalloc_bulk/kfree_bulk call in vm.c
+#define NMLFQ         3  // scheduler priority levels
+#define MLFQBOOST   100  // ticks between scheduler priority boosts
+#define MLFQQUANTUM   1  // ticks in a top-level slice, doubling per level
 
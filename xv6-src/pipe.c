@@ -84,15 +84,18 @@ pipewrite(struct pipe *p, char *addr, int n)
   for(i = 0; i < n; i++){
     while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
       if(p->readopen == 0 || myproc()->killed){
+        wakeupone(&p->nwrite);  // pass on a wakeup meant for a writer
         release(&p->lock);
         return -1;
       }
-      wakeup(&p->nread);
+      wakeupone(&p->nread);
       sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
     }
     p->data[p->nwrite++ % PIPESIZE] = addr[i];
   }
-  wakeup(&p->nread);  //DOC: pipewrite-wakeup1
+  wakeupone(&p->nread);  //DOC: pipewrite-wakeup1
+  if(p->nwrite != p->nread + PIPESIZE)
+    wakeupone(&p->nwrite);  // room left: pass it on to another writer
   release(&p->lock);
   return n;
 }
@@ -105,6 +108,7 @@ piperead(struct pipe *p, char *addr, int n)
   acquire(&p->lock);
   while(p->nread == p->nwrite && p->writeopen){  //DOC: pipe-empty
     if(myproc()->killed){
+      wakeupone(&p->nread);  // pass on a wakeup meant for a reader
       release(&p->lock);
       return -1;
     }
@@ -115,7 +119,9 @@ piperead(struct pipe *p, char *addr, int n)
       break;
     addr[i] = p->data[p->nread++ % PIPESIZE];
   }
-  wakeup(&p->nwrite);  //DOC: piperead-wakeup
+  wakeupone(&p->nwrite);  //DOC: piperead-wakeup
+  if(p->nread != p->nwrite)
+    wakeupone(&p->nread);  // data left: pass it on to another reader
   release(&p->lock);
   return i;
 }
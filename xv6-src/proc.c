@@ -6,24 +6,76 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "schedstat.h"
+#include "trace.h"
+#include "rusage.h"
+
+// Sleeping procs are chained (sqnext) on the bucket of their
+// chan, so wakeup only looks at procs that may be waiting on it.
+#define NSLEEPQ 64
+#define SLEEPQ(chan) (((uint)(chan) >> 3) % NSLEEPQ)
+
+// Address space shared by the threads clone() creates.  Each
+// thread holds a reference; the last one reaped frees the pgdir.
+// Each thread keeps its own copy of sz and stack, refreshed from
+// here by vmlock() and on each system call (vmsync).
+struct vmspace {
+  struct spinlock lock;  // serializes changes to mappings, sz, stack
+  int ref;               // threads using it, 0 if free
+  uint sz;               // size of the threads' memory
+  uint stack;            // bottom of the mapped main stack
+};
 
 struct {
   struct spinlock lock;
   struct proc proc[NPROC];
+  struct proc *sleepq[NSLEEPQ];
+  struct vmspace vm[NPROC];
+  struct rwlock pidlock;  // written with lock held, when a pid changes
 } ptable;
 
 static struct proc *initproc;
 
 int nextpid = 1;
+int childfirst = 0;  // fork() runs the child before the parent
+
+// Time slice, in ticks, of MLFQ level l.  A process starts at
+// its nice level, moves down a level each time it uses up a slice
+// and is raised back to its nice level every MLFQBOOST ticks.
+#define QUANTUM(l) (MLFQQUANTUM << (l))
 extern void forkret(void);
 extern void trapret(void);
 
-static void wakeup1(void *chan);
+static void run(struct cpu*, struct proc*);
+static void enqueue(struct cpu*, struct proc*, int);
+static struct proc* dequeue(struct cpu*);
+static struct proc* steal(void);
+static void handoff(struct cpu*, struct proc*);
+static void setrunnable(struct proc*);
+static int wakeup1(void *chan, int n);
+
+// Run queue locks, one per CPU, each on its own cache line.
+// struct cpu points to its lock, as proc.h can't embed a spinlock.
+// Lock order: ptable.lock, then a runq lock; at most one runq
+// lock is held at a time.
+static struct {
+  struct spinlock lock;
+} __attribute__((aligned(64))) rqlocks[NCPU];
 
 void
 pinit(void)
 {
-  initlock(&ptable.lock, "ptable");
+  struct vmspace *v;
+  int i;
+
+  for(i = 0; i < NCPU; i++){
+    initlock(&rqlocks[i].lock, "runq");
+    cpus[i].rqlock = &rqlocks[i].lock;
+  }
+  initmcslock(&ptable.lock, "ptable");
+  initrwlock(&ptable.pidlock, "pidlock");
+  for(v = ptable.vm; v < &ptable.vm[NPROC]; v++)
+    initlock(&v->lock, "vmspace");
 }
 
 // Must be called with interrupts disabled
@@ -32,19 +84,15 @@ cpuid() {
   return mycpu()-cpus;
 }
 
-// Must be called with interrupts disabled to avoid the caller being
-// rescheduled between reading lapicid and running through the loop.
+// Find this CPU's struct cpu by scanning for its local APIC ID.
+// seginit() does this once per CPU; after that, use mycpu().
 struct cpu*
-mycpu(void)
+findcpu(void)
 {
   int apicid, i;
   
-  if(readeflags()&FL_IF)
-    panic("mycpu called with interrupts enabled\n");
-  
   apicid = lapicid();
-  // APIC IDs are not guaranteed to be contiguous. Maybe we should have
-  // a reverse map, or reserve a register to store &cpus[i].
+  // APIC IDs are not guaranteed to be contiguous.
   for (i = 0; i < ncpu; ++i) {
     if (cpus[i].apicid == apicid)
       return &cpus[i];
@@ -52,16 +100,59 @@ mycpu(void)
   panic("unknown apicid\n");
 }
 
-// Disable interrupts so that we are not rescheduled
-// while reading proc from the cpu structure
+// Must be called with interrupts disabled to avoid the caller being
+// rescheduled onto another CPU while it uses the result.
+struct cpu*
+mycpu(void)
+{
+  struct cpu *c;
+
+  if(readeflags()&FL_IF)
+    panic("mycpu called with interrupts enabled\n");
+
+  asm volatile("movl %%gs:0, %0" : "=r" (c));
+  return c;
+}
+
+// A single load, so the process can't move to another
+// CPU halfway through reading the cpu structure.
 struct proc*
 myproc(void) {
-  struct cpu *c;
   struct proc *p;
-  pushcli();
-  c = mycpu();
-  p = c->proc;
-  popcli();
+
+  asm volatile("movl %%gs:4, %0" : "=r" (p));
+  return p;
+}
+
+// Mark p UNUSED.  It keeps its kernel stack and goes on this
+// CPU's freeproc list, so the next allocproc() here can reuse
+// the stack while it is likely still in the cache.
+// Caller must hold ptable.lock.
+static void
+freeproc(struct proc *p)
+{
+  struct cpu *c = mycpu();
+
+  acquirewrite(&ptable.pidlock);
+  p->pid = 0;
+  releasewrite(&ptable.pidlock);
+  p->parent = 0;
+  p->name[0] = 0;
+  p->killed = 0;
+  p->state = UNUSED;
+  p->nextfree = c->freeproc;
+  c->freeproc = p;
+}
+
+// Take a proc off c's freeproc list, or return 0.
+// Caller must hold ptable.lock.
+static struct proc*
+takefree(struct cpu *c)
+{
+  struct proc *p;
+
+  if((p = c->freeproc) != 0)
+    c->freeproc = p->nextfree;
   return p;
 }
 
@@ -74,12 +165,20 @@ static struct proc*
 allocproc(void)
 {
   struct proc *p;
+  struct cpu *c;
   char *sp;
 
   acquire(&ptable.lock);
 
+  // Prefer a proc whose kernel stack this CPU used last, then
+  // one that never had a stack, then one cached by another CPU.
+  if((p = takefree(mycpu())) != 0)
+    goto found;
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == UNUSED)
+    if(p->state == UNUSED && p->kstack == 0)
+      goto found;
+  for(c = cpus; c < cpus+ncpu; c++)
+    if((p = takefree(c)) != 0)
       goto found;
 
   release(&ptable.lock);
@@ -87,15 +186,35 @@ allocproc(void)
 
 found:
   p->state = EMBRYO;
+  acquirewrite(&ptable.pidlock);
   p->pid = nextpid++;
+  releasewrite(&ptable.pidlock);
+  p->cpu = 0;
+  p->queued = 0;
+  p->vm = 0;
+  p->timedout = 0;
+  p->nice = 0;
+  p->level = 0;
+  p->slice = 0;
+  p->runticks = 0;
+  p->waitticks = 0;
+  p->switches = 0;
+  p->utime = p->stime = 0;
+  p->minflt = p->cowflt = p->zfill = 0;
+  p->nvcsw = p->nivcsw = 0;
+  p->inblock = p->oublock = 0;
 
   release(&ptable.lock);
 
-  // Allocate kernel stack.
-  if((p->kstack = kalloc()) == 0){
+  // Allocate kernel stack, unless the proc kept its last one.
+  if(p->kstack == 0 && (p->kstack = kalloc()) == 0){
     p->state = UNUSED;
     return 0;
   }
+
+  // The trap frame and context sit at the same place in every
+  // stack; the context must be rebuilt, the caller fills the
+  // trap frame.
   sp = p->kstack + KSTACKSIZE;
 
   // Leave room for trap frame.
@@ -130,6 +249,7 @@ userinit(void)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
   p->sz = PGSIZE;
+  p->stack = USTACKTOP;  // initcode's stack is in its one page
   memset(p->tf, 0, sizeof(*p->tf));
   p->tf->cs = (SEG_UCODE << 3) | DPL_USER;
   p->tf->ds = (SEG_UDATA << 3) | DPL_USER;
@@ -148,30 +268,110 @@ userinit(void)
   // because the assignment might not be atomic.
   acquire(&ptable.lock);
 
-  p->state = RUNNABLE;
+  setrunnable(p);
 
   release(&ptable.lock);
 }
 
 // Grow current process's memory by n bytes.
-// Return 0 on success, -1 on failure.
+// Return the old size on success, -1 on failure.
+// Threads can't shrink their shared memory: another CPU may
+// still hold the freed pages in its TLB.
 int
 growproc(int n)
 {
-  uint sz;
+  uint sz, oldsz;
   struct proc *curproc = myproc();
 
-  sz = curproc->sz;
+  vmlock(curproc);
+  sz = oldsz = curproc->sz;
   if(n > 0){
+    if(n > USTACKBASE - sz)
+      goto bad;  // would run into the stack reserve
     if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
-      return -1;
+      goto bad;
   } else if(n < 0){
+    if(vmshared(curproc))
+      goto bad;
     if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
-      return -1;
+      goto bad;
   }
   curproc->sz = sz;
+  vmunlock(curproc);
   switchuvm(curproc);
-  return 0;
+  return oldsz;
+
+bad:
+  vmunlock(curproc);
+  return -1;
+}
+
+// Lock p's address space against its other threads, which may
+// grow it or take page faults in it at the same time.
+void
+vmlock(struct proc *p)
+{
+  if(p->vm){
+    acquire(&p->vm->lock);
+    vmsync(p);
+  }
+}
+
+// Unlock p's address space, first publishing p's sz and stack,
+// which the caller may have changed, to its other threads.
+void
+vmunlock(struct proc *p)
+{
+  if(p->vm == 0)
+    return;
+  p->vm->sz = p->sz;
+  p->vm->stack = p->stack;
+  release(&p->vm->lock);
+}
+
+// Refresh p's sz and stack from its address space, which another
+// thread may have grown or shrunk.  Called by p only.
+void
+vmsync(struct proc *p)
+{
+  if(p->vm){
+    p->sz = p->vm->sz;
+    p->stack = p->vm->stack;
+  }
+}
+
+// Does another thread use p's address space?
+// Caller must hold vmlock(p), which keeps clone() from adding one.
+int
+vmshared(struct proc *p)
+{
+  return p->vm && p->vm->ref > 1;
+}
+
+// Drop p's reference to its address space.  Returns p's pgdir if
+// no other thread uses it and the caller must free it, else 0.
+// Caller must hold ptable.lock.
+static pde_t*
+dropvm(struct proc *p)
+{
+  struct vmspace *v = p->vm;
+
+  p->vm = 0;
+  if(v && --v->ref > 0)
+    return 0;
+  return p->pgdir;
+}
+
+// dropvm() for exec(), which is replacing p's pgdir.
+pde_t*
+putvm(struct proc *p)
+{
+  pde_t *pgdir;
+
+  acquire(&ptable.lock);
+  pgdir = dropvm(p);
+  release(&ptable.lock);
+  return pgdir;
 }
 
 // Create a new process copying p as the parent.
@@ -190,14 +390,19 @@ fork(void)
   }
 
   // Copy process state from proc.
-  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
-    kfree(np->kstack);
-    np->kstack = 0;
-    np->state = UNUSED;
+  vmlock(curproc);
+  np->pgdir = copyuvm(curproc->pgdir, curproc->sz, curproc->stack,
+                      vmshared(curproc));
+  vmunlock(curproc);
+  if(np->pgdir == 0){
+    acquire(&ptable.lock);
+    freeproc(np);
+    release(&ptable.lock);
     return -1;
   }
   lcr3(V2P(curproc->pgdir));
   np->sz = curproc->sz;
+  np->stack = curproc->stack;
   np->parent = curproc;
   *np->tf = *curproc->tf;
 
@@ -208,6 +413,7 @@ fork(void)
     if(curproc->ofile[i])
       np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
+  np->nice = np->level = curproc->nice;
 
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
@@ -215,11 +421,265 @@ fork(void)
 
   acquire(&ptable.lock);
 
-  np->state = RUNNABLE;
+  // Hand this CPU straight to the child through c->next; the
+  // scheduler runs it and only then queues this process again (see
+  // handoff), so no idle CPU can run either out of turn.  In
+  // fork+exec the child then drops its CoW references at exec
+  // before the parent writes to the pages they shared.
+  if(childfirst){
+    np->state = RUNNABLE;
+    np->readytick = ticks;
+    np->cpu = mycpu();
+    np->cpu->next = np;
+    curproc->state = RUNNABLE;
+    curproc->readytick = ticks;
+    sched();
+  } else
+    setrunnable(np);
+
+  release(&ptable.lock);
+
+  return pid;
+}
+
+// Set whether fork() runs the child first; return the old setting.
+int
+setchildfirst(int on)
+{
+  int old;
+
+  acquire(&ptable.lock);
+  old = childfirst;
+  childfirst = on != 0;
+  release(&ptable.lock);
+  return old;
+}
+
+// Turn the current process into a template for spawn().
+// Its private pages are write-protected once, here, and it then
+// sleeps until killed: clones share its memory copy-on-write and
+// the template itself never runs again.
+int
+zygote(void)
+{
+  struct proc *curproc = myproc();
+
+  if(curproc->vm)
+    return -1;  // its threads would keep writing the shared pages
+  wrprotectuvm(curproc->pgdir, curproc->sz, curproc->stack);
+  lcr3(V2P(curproc->pgdir));
+
+  acquire(&ptable.lock);
+  curproc->zygote = 1;
+  while(!curproc->killed)
+    sleep(&curproc->zygote, &ptable.lock);
+  curproc->zygote = 0;
+  release(&ptable.lock);
+  return -1;
+}
+
+// Create a new process from the template process pid, resuming it
+// in user space at entry.  Like fork(), the clone shares the
+// template's pages copy-on-write, but the template's page table is
+// already write-protected and is not modified.  The caller, not the
+// template, becomes the parent.
+int
+spawn(int pid, uint entry)
+{
+  int i;
+  struct proc *np, *t;
+  struct proc *curproc = myproc();
+
+  // Allocate process.
+  if((np = allocproc()) == 0){
+    return -1;
+  }
+
+  // The template can't exit while we hold ptable.lock.
+  acquire(&ptable.lock);
+  for(t = ptable.proc; t < &ptable.proc[NPROC]; t++)
+    if(t->pid == pid && t->zygote && !t->killed)
+      break;
+  if(t == &ptable.proc[NPROC] || entry >= t->sz ||
+     (np->pgdir = cloneuvm(t->pgdir, t->sz, t->stack)) == 0){
+    freeproc(np);
+    release(&ptable.lock);
+    return -1;
+  }
+  np->sz = t->sz;
+  np->stack = t->stack;
+  np->parent = curproc;
+  *np->tf = *t->tf;
+
+  // Start at entry with the template's stack; return 0 like fork.
+  np->tf->eax = 0;
+  np->tf->eip = entry;
+
+  for(i = 0; i < NOFILE; i++)
+    if(t->ofile[i])
+      np->ofile[i] = filedup(t->ofile[i]);
+  np->cwd = idup(t->cwd);
+  np->nice = np->level = curproc->nice;
+
+  safestrcpy(np->name, t->name, sizeof(t->name));
+
+  pid = np->pid;
+
+  setrunnable(np);
+
+  release(&ptable.lock);
+
+  return pid;
+}
+
+// Create a thread: a process sharing the current process's page
+// table that starts at fn(arg), with the PGSIZE-byte user stack at
+// stack, which must lie below sz.  Like fork(), it gets the
+// parent's open files.  Returns the new thread's pid.
+int
+clone(uint fn, uint stack, uint arg)
+{
+  int i, pid;
+  struct proc *np;
+  struct vmspace *v;
+  struct proc *curproc = myproc();
+  uint ustack[2];
+
+  // Allocate process.
+  if((np = allocproc()) == 0){
+    return -1;
+  }
+
+  if(curproc->vm == 0){
+    acquire(&ptable.lock);
+    for(v = ptable.vm; v->ref != 0; v++)
+      ;  // a free one exists: each one in use has its own proc
+    v->ref = 1;
+    v->sz = curproc->sz;
+    v->stack = curproc->stack;
+    curproc->vm = v;
+    release(&ptable.lock);
+  }
+
+  vmlock(curproc);
+
+  // The first thread must not find copy-on-write pages: breaking
+  // one would leave the old page in the TLB of other CPUs.
+  if(!vmshared(curproc)){
+    if(unshareuvm(curproc->pgdir, curproc->sz, curproc->stack) < 0)
+      goto bad;
+    lcr3(V2P(curproc->pgdir));
+  }
 
+  ustack[0] = 0xffffffff;  // fake return PC
+  ustack[1] = arg;
+  if(stack + PGSIZE < stack || stack + PGSIZE > curproc->sz ||
+     copyout(curproc->pgdir, stack + PGSIZE - 8, ustack, 8) < 0)
+    goto bad;
+
+  np->pgdir = curproc->pgdir;
+  np->sz = curproc->sz;
+  np->stack = curproc->stack;
+  np->ustack = stack;
+  np->parent = curproc;
+  *np->tf = *curproc->tf;
+  np->tf->eip = fn;
+  np->tf->esp = stack + PGSIZE - 8;
+
+  for(i = 0; i < NOFILE; i++)
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  np->cwd = idup(curproc->cwd);
+  np->nice = np->level = curproc->nice;
+
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+
+  pid = np->pid;
+
+  acquire(&ptable.lock);
+  np->vm = curproc->vm;
+  np->vm->ref++;
+  setrunnable(np);
   release(&ptable.lock);
 
+  vmunlock(curproc);
+
   return pid;
+
+bad:
+  vmunlock(curproc);
+  acquire(&ptable.lock);
+  freeproc(np);
+  release(&ptable.lock);
+  return -1;
+}
+
+static void
+getusage(struct proc *p, struct rusage *ru)
+{
+  ru->utime = p->utime;
+  ru->stime = p->stime;
+  ru->minflt = p->minflt;
+  ru->cowflt = p->cowflt;
+  ru->zfill = p->zfill;
+  ru->nvcsw = p->nvcsw;
+  ru->nivcsw = p->nivcsw;
+  ru->inblock = p->inblock;
+  ru->oublock = p->oublock;
+}
+
+// Charge the usage of thread t to p, the process that joins it.
+static void
+addusage(struct proc *p, struct proc *t)
+{
+  p->utime += t->utime;
+  p->stime += t->stime;
+  p->minflt += t->minflt;
+  p->cowflt += t->cowflt;
+  p->zfill += t->zfill;
+  p->nvcsw += t->nvcsw;
+  p->nivcsw += t->nivcsw;
+  p->inblock += t->inblock;
+  p->oublock += t->oublock;
+}
+
+// Wait for a thread this process clone()d to exit and return its
+// pid, storing the user stack it was given in *ustack.
+// Return -1 if this process has no threads.
+int
+join(uint *ustack)
+{
+  struct proc *p;
+  int havekids, pid;
+  struct proc *curproc = myproc();
+
+  acquire(&ptable.lock);
+  for(;;){
+    // Scan through table looking for exited threads.
+    havekids = 0;
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+      if(p->parent != curproc || p->vm == 0 || p->vm != curproc->vm)
+        continue;
+      havekids = 1;
+      if(p->state == ZOMBIE){
+        // Found one.  The pgdir stays in use by curproc.
+        pid = p->pid;
+        *ustack = p->ustack;
+        addusage(curproc, p);
+        dropvm(p);
+        freeproc(p);
+        release(&ptable.lock);
+        return pid;
+      }
+    }
+
+    if(!havekids || curproc->killed){
+      release(&ptable.lock);
+      return -1;
+    }
+
+    sleep(curproc, &ptable.lock);
+  }
 }
 
 // Exit the current process.  Does not return.
@@ -251,14 +711,14 @@ exit(void)
   acquire(&ptable.lock);
 
   // Parent might be sleeping in wait().
-  wakeup1(curproc->parent);
+  wakeup1(curproc->parent, 0);
 
   // Pass abandoned children to init.
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
     if(p->parent == curproc){
       p->parent = initproc;
       if(p->state == ZOMBIE)
-        wakeup1(initproc);
+        wakeup1(initproc, 0);
     }
   }
 
@@ -272,31 +732,40 @@ exit(void)
 // Return -1 if this process has no children.
 int
 wait(void)
+{
+  return wait2(0);
+}
+
+// Like wait(), but also copy the child's resource usage to ru
+// unless it is 0.  ru must be a kernel address.
+int
+wait2(struct rusage *ru)
 {
   struct proc *p;
   int havekids, pid;
+  pde_t *pgdir;
   struct proc *curproc = myproc();
   
   acquire(&ptable.lock);
   for(;;){
     // Scan through table looking for exited children.
+    // Threads are left for join().
     havekids = 0;
     for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
+      if(p->parent != curproc || (p->vm && p->vm == curproc->vm))
         continue;
       havekids = 1;
       if(p->state == ZOMBIE){
         // Found one.
         pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        p->state = UNUSED;
+        if(ru)
+          getusage(p, ru);
+        if((pgdir = dropvm(p)) != 0 && freevmlater(pgdir) == 0)
+          pgdir = 0;
+        freeproc(p);
         release(&ptable.lock);
+        if(pgdir)
+          freevm(pgdir);  // the queue was full
         return pid;
       }
     }
@@ -331,29 +800,320 @@ scheduler(void)
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
-    acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->state != RUNNABLE)
-        continue;
+    // Run the next process queued here, or steal one.  Finding
+    // it takes only run queue locks; ptable.lock is held just for
+    // the switch, which it guards as in sched().  A process
+    // dequeued while still switching out (it queued itself in
+    // yield()) is not run until its CPU drops ptable.lock.
+    if((p = dequeue(c)) != 0 || (p = steal()) != 0){
+      acquire(&ptable.lock);
+      run(c, p);
+      handoff(c, p);
+      release(&ptable.lock);
+    } else {
+      // Nothing to run: free some exited address spaces.
+      reapvm(NREAPBATCH);
+    }
+  }
+}
+
+// Run the child that p, just switched out, left in c->next when
+// forking with childfirst set, and then that child's own, if any.
+// The parents wait off the run queues, chained on rqnext, until
+// the last child switches out, so no other CPU runs them first.
+// Caller must hold ptable.lock.
+static void
+handoff(struct cpu *c, struct proc *p)
+{
+  struct proc *np, *parents;
+
+  parents = 0;
+  while((np = c->next) != 0){
+    c->next = 0;
+    p->rqnext = parents;
+    parents = p;
+    run(c, np);
+    p = np;
+  }
+  while((p = parents) != 0){
+    parents = p->rqnext;
+    setrunnable(p);
+  }
+}
+
+// Insert p in c's run queue for its level, at the head if head
+// is set.  Caller must hold c->rqlock.
+static void
+rqinsert(struct cpu *c, struct proc *p, int head)
+{
+  int l = p->level;
+
+  if(head){
+    p->rqnext = c->runq[l];
+    c->runq[l] = p;
+    if(c->runqtail[l] == 0)
+      c->runqtail[l] = p;
+  } else {
+    p->rqnext = 0;
+    if(c->runqtail[l])
+      c->runqtail[l]->rqnext = p;
+    else
+      c->runq[l] = p;
+    c->runqtail[l] = p;
+  }
+  p->queued = 1;
+  c->nrunq++;
+}
 
-      // Switch to chosen process.  It is the process's job
-      // to release ptable.lock and then reacquire it
-      // before jumping back to us.
-      c->proc = p;
-      switchuvm(p);
-      p->state = RUNNING;
+// Remove queued p from c's run queue.  Caller must hold c->rqlock.
+static void
+rqremove(struct cpu *c, struct proc *p)
+{
+  struct proc **pp, *prev;
+  int l = p->level;
+
+  prev = 0;
+  for(pp = &c->runq[l]; *pp != p; pp = &(*pp)->rqnext)
+    prev = *pp;
+  *pp = p->rqnext;
+  if(c->runqtail[l] == p)
+    c->runqtail[l] = prev;
+  p->queued = 0;
+  c->nrunq--;
+}
+
+// Add p to c's run queue for its level, at the head if head
+// is set.
+static void
+enqueue(struct cpu *c, struct proc *p, int head)
+{
+  acquire(c->rqlock);
+  rqinsert(c, p, head);
+  release(c->rqlock);
+}
 
-      swtch(&(c->scheduler), p->context);
-      switchkvm();
+// Take the process at the head of c's highest-priority
+// non-empty queue, or return 0.  An empty queue is seen
+// without its lock, so idle CPUs don't bounce the lines.
+static struct proc*
+dequeue(struct cpu *c)
+{
+  struct proc *p;
+  int l;
 
-      // Process is done running for now.
-      // It should have changed its p->state before coming back.
-      c->proc = 0;
+  if(c->nrunq == 0)
+    return 0;
+  acquire(c->rqlock);
+  for(l = 0; l < NMLFQ; l++){
+    if((p = c->runq[l]) != 0){
+      rqremove(c, p);
+      release(c->rqlock);
+      return p;
     }
+  }
+  release(c->rqlock);
+  return 0;
+}
+
+// Take a process from the longest run queue, or return 0.
+// Called by CPUs whose own queue is empty.  The lengths are
+// read without locks; dequeue() rechecks under the victim's.
+static struct proc*
+steal(void)
+{
+  struct cpu *c, *busiest;
+  int n;
+
+  busiest = 0;
+  n = 0;
+  for(c = cpus; c < cpus+ncpu; c++)
+    if(c->nrunq > n){
+      n = c->nrunq;
+      busiest = c;
+    }
+  if(busiest == 0)
+    return 0;
+  return dequeue(busiest);
+}
+
+// Move p to level, requeueing it if it waits on a run queue.
+// Caller must hold ptable.lock, which keeps p->cpu from changing.
+static void
+setlevel(struct proc *p, int level)
+{
+  struct cpu *c = p->cpu;
+
+  if(c == 0){
+    p->level = level;
+    return;
+  }
+  acquire(c->rqlock);
+  if(p->queued){
+    rqremove(c, p);
+    p->level = level;
+    rqinsert(c, p, 0);
+  } else
+    p->level = level;
+  release(c->rqlock);
+}
+
+// Make p RUNNABLE and queue it on the CPU it last ran on,
+// whose cache may still hold its state, or on this CPU if it
+// has not run yet.  Caller must hold ptable.lock.
+static void
+setrunnable(struct proc *p)
+{
+  if(p->cpu == 0)
+    p->cpu = mycpu();
+  p->state = RUNNABLE;
+  p->readytick = ticks;
+  enqueue(p->cpu, p, 0);
+}
+
+// Charge the running process for a timer tick.  Returns 1 if it
+// should give up the CPU: it has used up its slice at this level,
+// and so moves down one, or a higher level has work queued here.
+// Only this CPU changes its running process's slice and level.
+int
+schedtick(void)
+{
+  struct proc *p = myproc();
+  struct cpu *c = mycpu();
+  int l;
+
+  p->runticks++;
+  if(++p->slice >= QUANTUM(p->level)){
+    p->slice = 0;
+    if(p->level < NMLFQ-1)
+      p->level++;
+    return 1;
+  }
+  for(l = 0; l < p->level; l++)
+    if(c->runq[l])
+      return 1;
+  return 0;
+}
+
+// Raise every process back to its nice level, so that processes
+// pushed down by CPU-bound phases are not starved.
+// Called every MLFQBOOST ticks.
+void
+schedboost(void)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->state == UNUSED || p->level == p->nice)
+      continue;
+    setlevel(p, p->nice);
+    p->slice = 0;
+  }
+  release(&ptable.lock);
+}
+
+// Set the nice level (0 to NMLFQ-1, highest priority first) of
+// process pid and move it there now.  Returns the old nice level,
+// or -1 if there is no such process.
+int
+setpriority(int pid, int nice)
+{
+  struct proc *p;
+  int old;
+
+  if(nice < 0 || nice >= NMLFQ)
+    return -1;
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid != pid || p->state == UNUSED)
+      continue;
+    old = p->nice;
+    p->nice = nice;
+    setlevel(p, nice);
+    p->slice = 0;
     release(&ptable.lock);
+    return old;
+  }
+  release(&ptable.lock);
+  return -1;
+}
 
+// Copy the scheduling statistics of process pid, or of the
+// caller if pid is 0, to st, which may be a user address.
+int
+getschedstat(int pid, struct schedstat *st)
+{
+  struct schedstat s;
+  struct proc *p;
+
+  if(pid == 0)
+    pid = myproc()->pid;
+  acquireread(&ptable.pidlock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->pid == pid && p->state != UNUSED)
+      break;
+  if(p == &ptable.proc[NPROC]){
+    releaseread(&ptable.pidlock);
+    return -1;
+  }
+  s.level = p->level;
+  s.nice = p->nice;
+  s.runticks = p->runticks;
+  s.waitticks = p->waitticks;
+  s.switches = p->switches;
+  releaseread(&ptable.pidlock);
+
+  // A CoW fault on st takes locks of its own; copy outside ptable.lock.
+  *st = s;
+  return 0;
+}
+
+// Copy the resource usage of process pid, or of the caller if
+// pid is 0, to ru, which may be a user address.
+int
+getrusage(int pid, struct rusage *ru)
+{
+  struct rusage r;
+  struct proc *p;
+
+  if(pid == 0)
+    pid = myproc()->pid;
+  acquireread(&ptable.pidlock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->pid == pid && p->state != UNUSED)
+      break;
+  if(p == &ptable.proc[NPROC]){
+    releaseread(&ptable.pidlock);
+    return -1;
   }
+  getusage(p, &r);
+  releaseread(&ptable.pidlock);
+
+  // A CoW fault on ru takes locks of its own; copy outside ptable.pidlock.
+  *ru = r;
+  return 0;
+}
+
+// Switch to chosen process p on cpu c.  It is the process's job
+// to release ptable.lock and then reacquire it
+// before jumping back to us.
+static void
+run(struct cpu *c, struct proc *p)
+{
+  c->proc = p;
+  p->cpu = c;
+  p->waitticks += ticks - p->readytick;
+  p->switches++;
+  switchuvm(p);
+  p->state = RUNNING;
+  trace(TR_SWTCHIN, p->level, 0, 0, 0);
+
+  swtch(&(c->scheduler), p->context);
+  switchkvm();
+
+  // Process is done running for now.
+  // It should have changed its p->state before coming back.
+  c->proc = 0;
 }
 
 // Enter scheduler.  Must hold only ptable.lock
@@ -378,6 +1138,11 @@ sched(void)
   if(readeflags()&FL_IF)
     panic("sched interruptible");
   intena = mycpu()->intena;
+  if(p->state == SLEEPING)
+    p->nvcsw++;
+  else if(p->state == RUNNABLE)
+    p->nivcsw++;
+  trace(TR_SWTCHOUT, p->state, (uint)p->chan, 0, 0);
   swtch(&p->context, mycpu()->scheduler);
   mycpu()->intena = intena;
 }
@@ -387,7 +1152,7 @@ void
 yield(void)
 {
   acquire(&ptable.lock);  //DOC: yieldlock
-  myproc()->state = RUNNABLE;
+  setrunnable(myproc());
   sched();
   release(&ptable.lock);
 }
@@ -419,6 +1184,7 @@ void
 sleep(void *chan, struct spinlock *lk)
 {
   struct proc *p = myproc();
+  struct proc **pp;
   
   if(p == 0)
     panic("sleep");
@@ -436,14 +1202,25 @@ sleep(void *chan, struct spinlock *lk)
     acquire(&ptable.lock);  //DOC: sleeplock1
     release(lk);
   }
-  // Go to sleep.
-  p->chan = chan;
-  p->state = SLEEPING;
-
-  sched();
-
-  // Tidy up.
-  p->chan = 0;
+  // A timer that fired since the caller checked its condition
+  // (see wakeproc) counts as a wakeup.
+  if(p->timedout){
+    p->timedout = 0;
+  } else {
+    // Go to sleep, at the tail of chan's queue so that
+    // wakeupone() wakes the longest sleeper.
+    p->chan = chan;
+    p->state = SLEEPING;
+    p->sqnext = 0;
+    for(pp = &ptable.sleepq[SLEEPQ(chan)]; *pp; pp = &(*pp)->sqnext)
+      ;
+    *pp = p;
+
+    sched();
+
+    // Tidy up.
+    p->chan = 0;
+  }
 
   // Reacquire original lock.
   if(lk != &ptable.lock){  //DOC: sleeplock2
@@ -453,16 +1230,68 @@ sleep(void *chan, struct spinlock *lk)
 }
 
 //PAGEBREAK!
-// Wake up all processes sleeping on chan.
+// Wake up all processes sleeping on chan, or if n is set only
+// the n that have slept longest.  Returns the number woken.
 // The ptable lock must be held.
+static int
+wakeup1(void *chan, int n)
+{
+  struct proc **pp, *p;
+  int woken;
+
+  woken = 0;
+  pp = &ptable.sleepq[SLEEPQ(chan)];
+  while((p = *pp) != 0){
+    if(p->chan != chan){
+      pp = &p->sqnext;
+      continue;
+    }
+    *pp = p->sqnext;
+    setrunnable(p);
+    if(++woken == n)
+      break;
+  }
+  return woken;
+}
+
+// Take p, which is SLEEPING, off its chan's queue and make
+// it RUNNABLE.  The ptable lock must be held.
 static void
-wakeup1(void *chan)
+unsleep(struct proc *p)
 {
-  struct proc *p;
+  struct proc **pp;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+  for(pp = &ptable.sleepq[SLEEPQ(p->chan)]; *pp != p; pp = &(*pp)->sqnext)
+    ;
+  *pp = p->sqnext;
+  setrunnable(p);
+}
+
+// Wake p from whatever it is sleeping on; used by timers.
+// If p is not asleep yet, make its next sleep() return at once,
+// so a timeout between checking a condition and sleeping is not
+// lost.  Callers of sleep() loop on their condition, so an early
+// return costs only a recheck.
+void
+wakeproc(struct proc *p)
+{
+  acquire(&ptable.lock);
+  if(p->state == SLEEPING)
+    unsleep(p);
+  else
+    p->timedout = 1;
+  release(&ptable.lock);
+}
+
+// Forget a wakeproc() that found the current process awake, for
+// a timer the caller saw fire (ktimercancel) and no longer waits
+// on; otherwise the next, unrelated sleep() would return at once.
+void
+untimeout(void)
+{
+  acquire(&ptable.lock);
+  myproc()->timedout = 0;
+  release(&ptable.lock);
 }
 
 // Wake up all processes sleeping on chan.
@@ -470,31 +1299,61 @@ void
 wakeup(void *chan)
 {
   acquire(&ptable.lock);
-  wakeup1(chan);
+  wakeup1(chan, 0);
+  release(&ptable.lock);
+}
+
+// Wake up one process sleeping on chan, for handoffs where
+// only one waiter can make progress.  A waiter woken this way
+// that leaves the condition still true must pass it on.
+void
+wakeupone(void *chan)
+{
+  acquire(&ptable.lock);
+  wakeup1(chan, 1);
+  release(&ptable.lock);
+}
+
+// Wake up the n processes that have slept longest on chan.
+// Returns the number woken.
+int
+wakeupn(void *chan, int n)
+{
+  int woken;
+
+  acquire(&ptable.lock);
+  woken = wakeup1(chan, n);
   release(&ptable.lock);
+  return woken;
 }
 
 // Kill the process with the given pid.
 // Process won't exit until it returns
 // to user space (see trap in trap.c).
+// The search only needs pidlock; ptable.lock is taken just to
+// wake the process, which may have exited by then.
 int
 kill(int pid)
 {
   struct proc *p;
 
-  acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
-    }
+  acquireread(&ptable.pidlock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->pid == pid)
+      break;
+  if(p == &ptable.proc[NPROC]){
+    releaseread(&ptable.pidlock);
+    return -1;
   }
+  p->killed = 1;
+  releaseread(&ptable.pidlock);
+
+  // Wake process from sleep if necessary.
+  acquire(&ptable.lock);
+  if(p->pid == pid && p->state == SLEEPING)
+    unsleep(p);
   release(&ptable.lock);
-  return -1;
+  return 0;
 }
 
 //PAGEBREAK: 36
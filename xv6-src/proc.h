@@ -1,5 +1,9 @@
-// Per-CPU state
+// Per-CPU state, addressed through %gs on each CPU (see seginit),
+// so per-CPU variables belong here.  self and proc come first: mycpu()
+// and myproc() read them as %gs:0 and %gs:4.
 struct cpu {
+  struct cpu *self;            // This struct cpu
+  struct proc *proc;           // The process running on this cpu or null
   uchar apicid;                // Local APIC ID
   struct context *scheduler;   // swtch() here to enter scheduler
   struct taskstate ts;         // Used by x86 to find stack for interrupt
@@ -7,7 +11,13 @@ struct cpu {
   volatile uint started;       // Has the CPU started?
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
-  struct proc *proc;           // The process running on this cpu or null
+  struct spinlock *rqlock;     // Guards runq, runqtail, nrunq
+  struct proc *runq[NMLFQ];    // RUNNABLE procs queued here, per level
+  struct proc *runqtail[NMLFQ];
+  volatile int nrunq;          // Procs queued on all levels
+  struct proc *next;           // Forked child to run next (see handoff)
+  uint64 starttsc;             // TSC when it entered the scheduler
+  struct proc *freeproc;       // UNUSED procs whose kstack ran here last
 };
 
 extern struct cpu cpus[NCPU];
@@ -37,6 +47,7 @@ enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 // Per-process state
 struct proc {
   uint sz;                     // Size of process memory (bytes)
+  uint stack;                  // Lowest user stack page faulted in
   pde_t* pgdir;                // Page table
   char *kstack;                // Bottom of kernel stack for this process
   enum procstate state;        // Process state
@@ -46,6 +57,31 @@ struct proc {
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
   int killed;                  // If non-zero, have been killed
+  int zygote;                  // If non-zero, template for spawn()
+  struct proc *nextfree;       // Next on a cpu's freeproc list
+  struct cpu *cpu;             // CPU whose run queue it last joined
+  struct proc *rqnext;         // Next on that run queue
+  int queued;                  // On cpu's run queue (under its rqlock)
+  struct proc *sqnext;         // Next sleeping on the same chan hash
+  struct vmspace *vm;          // If non-zero, shared with threads
+  uint ustack;                 // User stack clone() gave this thread
+  int timedout;                // wakeproc() came before sleep()
+  int nice;                    // MLFQ level it starts and is boosted to
+  int level;                   // Current MLFQ level, 0 is highest
+  int slice;                   // Ticks run at this level
+  uint readytick;              // When it last became RUNNABLE
+  uint runticks;               // Ticks spent running
+  uint waitticks;              // Ticks spent RUNNABLE, waiting for a CPU
+  uint switches;               // Times it has been scheduled
+  uint utime;                  // Timer ticks in user mode
+  uint stime;                  // Timer ticks in the kernel
+  uint minflt;                 // Page faults handled
+  uint cowflt;                 // Of which CoW faults
+  uint zfill;                  // Of which zero-fill faults
+  uint nvcsw;                  // Context switches to sleep
+  uint nivcsw;                 // Context switches by preemption
+  uint inblock;                // Disk blocks read
+  uint oublock;                // Disk blocks dirtied, at log_write
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
@@ -0,0 +1,238 @@
+// Sampling profiler: run a command and print the functions in which
+// the timer interrupts found the CPUs most often.
+//   prof [-p period] cmd args
+// samples every period-th tick (default 1) on each CPU.  Addresses
+// are looked up in the symbol tables in /sym: /sym/kernel for kernel
+// samples, and /sym/<name> for the user samples of process name.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "param.h"
+#include "prof.h"
+
+#define NTOP 15
+#define NTAB 8     // symbol tables: the kernel's and programs'
+
+struct sym {
+  uint addr;
+  char *name;
+  int hits;
+};
+
+struct symtab {
+  char name[16];
+  struct sym *sym;   // sorted by addr
+  int n;
+  int missed;        // samples not in any symbol
+};
+
+struct symtab tab[NTAB];
+int ntab;
+struct profsample samples[NCPU*NPROFSAMPLE];
+
+uint
+hex(char **sp)
+{
+  char *s;
+  uint x;
+
+  x = 0;
+  for(s = *sp; ; s++){
+    if(*s >= '0' && *s <= '9')
+      x = x*16 + *s - '0';
+    else if(*s >= 'a' && *s <= 'f')
+      x = x*16 + *s - 'a' + 10;
+    else
+      break;
+  }
+  *sp = s;
+  return x;
+}
+
+// File and section names (cat.c, .text) aren't functions.
+int
+isfunc(char *name)
+{
+  int n;
+
+  n = strlen(name);
+  if(n == 0 || name[0] == '.')
+    return 0;
+  if(n > 2 && name[n-2] == '.' && (name[n-1] == 'c' || name[n-1] == 'S'))
+    return 0;
+  return 1;
+}
+
+// Read the "addr name" lines of /sym/name into t.
+void
+load(struct symtab *t)
+{
+  char path[32], *buf, *p, *q;
+  int fd, n, i, j;
+  struct stat st;
+  struct sym s;
+
+  strcpy(path, "/sym/");
+  strcpy(path+5, t->name);
+  if((fd = open(path, O_RDONLY)) < 0)
+    return;
+  if(fstat(fd, &st) < 0 || (buf = malloc(st.size + 1)) == 0){
+    close(fd);
+    return;
+  }
+  for(n = 0; n < st.size; n += i)
+    if((i = read(fd, buf + n, st.size - n)) <= 0)
+      break;
+  buf[n] = 0;
+  close(fd);
+
+  for(i = 0, p = buf; *p; p++)
+    if(*p == '\n')
+      i++;
+  if((t->sym = malloc(i * sizeof(struct sym))) == 0)
+    return;
+
+  for(p = buf; *p; p = q){
+    if((q = strchr(p, '\n')) == 0)
+      break;
+    *q++ = 0;
+    s.addr = hex(&p);
+    if(*p++ != ' ' || !isfunc(p))
+      continue;
+    s.name = p;
+    s.hits = 0;
+    // Insertion sort; the tables are a few hundred lines.
+    for(j = t->n; j > 0 && t->sym[j-1].addr > s.addr; j--)
+      t->sym[j] = t->sym[j-1];
+    t->sym[j] = s;
+    t->n++;
+  }
+}
+
+// The symbol table for name, loaded on first use.
+struct symtab*
+symtab(char *name)
+{
+  struct symtab *t;
+
+  for(t = tab; t < &tab[ntab]; t++)
+    if(strcmp(t->name, name) == 0)
+      return t;
+  if(ntab == NTAB)
+    return 0;
+  t = &tab[ntab++];
+  memmove(t->name, name, sizeof(t->name) - 1);
+  load(t);
+  return t;
+}
+
+// The function containing addr: the last symbol at or below it.
+struct sym*
+lookup(struct symtab *t, uint addr)
+{
+  int lo, hi, mid;
+
+  lo = 0;
+  hi = t->n;
+  while(lo < hi){
+    mid = (lo + hi) / 2;
+    if(t->sym[mid].addr <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo > 0 ? &t->sym[lo-1] : 0;
+}
+
+void
+report(int n, int dropped)
+{
+  struct profsample *s;
+  struct symtab *t, *bt;
+  struct sym *sym, *best;
+  int i, k, idle, user, missed;
+
+  idle = user = missed = 0;
+  for(s = samples; s < &samples[n]; s++){
+    if(s->pid == 0){
+      idle++;
+      continue;
+    }
+    if(s->user)
+      user++;
+    s->name[sizeof(s->name)-1] = 0;
+    t = symtab(s->user ? s->name : "kernel");
+    if(t == 0 || (sym = lookup(t, s->eip)) == 0){
+      if(t)
+        t->missed++;
+      missed++;
+      continue;
+    }
+    sym->hits++;
+  }
+
+  printf(1, "%d samples: %d kernel, %d user, %d idle, %d unknown, %d dropped\n",
+         n, n - idle - user, user, idle, missed, dropped);
+  if(n == idle)
+    return;
+  printf(1, "%s\t%s\t%s\n", "%", "hits", "function");
+  for(k = 0; k < NTOP; k++){
+    best = 0;
+    bt = 0;
+    for(t = tab; t < &tab[ntab]; t++)
+      for(i = 0; i < t->n; i++)
+        if(t->sym[i].hits > 0 && (best == 0 || t->sym[i].hits > best->hits)){
+          best = &t->sym[i];
+          bt = t;
+        }
+    if(best == 0)
+      break;
+    printf(1, "%d\t%d\t%s [%s]\n", best->hits*100 / (n - idle), best->hits,
+           best->name, bt->name);
+    best->hits = 0;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid, period, n, dropped;
+
+  period = 1;
+  if(argc > 2 && strcmp(argv[1], "-p") == 0){
+    period = atoi(argv[2]);
+    argc -= 2;
+    argv += 2;
+  }
+  if(argc < 2 || period < 1){
+    printf(2, "usage: prof [-p period] cmd args\n");
+    exit();
+  }
+
+  if(profstart(period) < 0){
+    printf(2, "prof: profstart failed\n");
+    exit();
+  }
+  pid = fork();
+  if(pid < 0){
+    printf(2, "prof: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(argv[1], argv+1);
+    printf(2, "prof: exec %s failed\n", argv[1]);
+    exit();
+  }
+  wait();
+  dropped = profstop();
+
+  n = profread(samples, NCPU*NPROFSAMPLE);
+  if(n < 0){
+    printf(2, "prof: profread failed\n");
+    exit();
+  }
+  report(n, dropped);
+  exit();
+}
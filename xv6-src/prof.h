@@ -0,0 +1,10 @@
+#define NPROFSAMPLE 1024  // samples buffered per CPU
+
+// A timer-interrupt sample, returned by profread().
+struct profsample {
+  uint eip;          // interrupted instruction
+  int pid;           // interrupted process, 0 if the CPU was idle
+  char name[16];     // its name, for finding its symbols
+  uchar cpu;
+  uchar user;        // 1 if eip is a user address
+};
@@ -0,0 +1,143 @@
+// Sampling profiler.
+//
+// While profiling is on, every period-th timer interrupt on each CPU
+// records the interrupted eip, pid and mode into that CPU's ring.
+// profread() drains the rings.  A CPU only writes its own ring's head
+// and only with interrupts off, and profread() only moves the tails,
+// under prof.lock, so the interrupt path takes no lock.  A sample
+// that finds its ring full is counted as dropped.
+//
+// profstart() empties the rings while sampling is off.  A timer
+// interrupt already past the check of period can still store one
+// sample into the emptied ring.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "prof.h"
+
+struct profring {
+  struct profsample s[NPROFSAMPLE];
+  volatile uint head;   // next slot to fill, by this CPU
+  volatile uint tail;   // next slot to drain, by profread()
+  uint ticks;           // timer interrupts since the last sample
+} __attribute__((aligned(64)));
+
+static struct {
+  struct spinlock lock;
+  volatile int period;  // sample every period-th tick; 0 if off
+  volatile uint dropped;
+  struct profring ring[NCPU];
+} prof;
+
+void
+profinit(void)
+{
+  initlock(&prof.lock, "prof");
+}
+
+// Record a sample of the interrupted context tf if it is due.
+// Called from every CPU's timer interrupt.
+void
+proftick(struct trapframe *tf)
+{
+  struct profring *r;
+  struct profsample *s;
+  struct proc *p;
+  int period;
+
+  if((period = prof.period) == 0)
+    return;
+  r = &prof.ring[cpuid()];
+  if(++r->ticks < period)
+    return;
+  r->ticks = 0;
+  if(r->head - r->tail == NPROFSAMPLE){
+    __sync_fetch_and_add(&prof.dropped, 1);
+    return;
+  }
+  s = &r->s[r->head % NPROFSAMPLE];
+  p = myproc();
+  s->eip = tf->eip;
+  s->pid = p ? p->pid : 0;
+  if(p)
+    safestrcpy(s->name, p->name, sizeof(s->name));
+  else
+    s->name[0] = 0;
+  s->cpu = cpuid();
+  s->user = (tf->cs & 3) == DPL_USER;
+  __sync_synchronize();  // sample before head
+  r->head++;
+}
+
+// Start sampling every period-th tick, discarding old samples.
+int
+profstart(int period)
+{
+  struct profring *r;
+
+  if(period < 1)
+    return -1;
+  acquire(&prof.lock);
+  prof.period = 0;
+  __sync_synchronize();
+  for(r = prof.ring; r < &prof.ring[NCPU]; r++){
+    r->head = r->tail = 0;
+    r->ticks = 0;
+  }
+  prof.dropped = 0;
+  __sync_synchronize();
+  prof.period = period;
+  release(&prof.lock);
+  return 0;
+}
+
+// Stop sampling; the samples taken stay readable.
+// Returns the number of samples dropped for lack of room.
+int
+profstop(void)
+{
+  int dropped;
+
+  acquire(&prof.lock);
+  prof.period = 0;
+  dropped = prof.dropped;
+  release(&prof.lock);
+  return dropped;
+}
+
+// Move up to n samples to user address addr, a chunk at a time so
+// user memory is written without prof.lock.  Returns the number of
+// samples read.
+int
+profread(uint addr, int n)
+{
+  struct profsample chunk[16];
+  struct profring *r;
+  int k, total;
+
+  for(total = 0; total < n; total += k){
+    acquire(&prof.lock);
+    k = 0;
+    for(r = prof.ring; r < &prof.ring[ncpu] && k < NELEM(chunk) &&
+        total + k < n; r++){
+      while(r->tail != r->head && k < NELEM(chunk) && total + k < n){
+        __sync_synchronize();  // head before sample
+        chunk[k++] = r->s[r->tail % NPROFSAMPLE];
+        r->tail++;
+      }
+    }
+    release(&prof.lock);
+    if(k == 0)
+      break;
+    // addr may be an untouched stack page, which faults in here.
+    memmove((char*)addr + total*sizeof(chunk[0]), chunk,
+            k*sizeof(chunk[0]));
+  }
+  return total;
+}
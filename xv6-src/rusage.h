@@ -0,0 +1,12 @@
+// Resource usage of a process, returned by getrusage() and wait2().
+struct rusage {
+  uint utime;      // timer ticks in user mode
+  uint stime;      // timer ticks in the kernel
+  uint minflt;     // page faults handled without disk I/O
+  uint cowflt;     //   of which copied a CoW page
+  uint zfill;      //   of which mapped zero-filled pages
+  uint nvcsw;      // voluntary context switches: slept
+  uint nivcsw;     // involuntary context switches: preempted
+  uint inblock;    // blocks read from disk
+  uint oublock;    // blocks this process dirtied for the disk
+};
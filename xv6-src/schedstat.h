@@ -0,0 +1,8 @@
+// Scheduling statistics of a process, returned by getschedstat().
+struct schedstat {
+  int level;       // current MLFQ level, 0 is highest priority
+  int nice;        // level it starts at and is boosted back to
+  uint runticks;   // ticks spent running
+  uint waitticks;  // ticks spent runnable, waiting for a CPU
+  uint switches;   // times it has been scheduled
+};
@@ -17,17 +17,27 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+  lk->cls = 0;
 }
 
+// Contention is counted under lk->lk, with interrupts off,
+// as lockclass.c requires.
 void
 acquiresleep(struct sleeplock *lk)
 {
+  uint64 t0;
+
   acquire(&lk->lk);
+  t0 = lk->locked ? rdtsc() : 0;
   while (lk->locked) {
     sleep(lk, &lk->lk);
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+  lk->tsc = rdtsc();
+  if(lk->cls == 0 && lk->name)
+    lk->cls = lockclass(lk->name, 1);
+  lockcount(lk->cls, t0 != 0, lk->tsc - t0);
   release(&lk->lk);
 }
 
@@ -35,9 +45,10 @@ void
 releasesleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+  lockhold(lk->cls, rdtsc() - lk->tsc);
   lk->locked = 0;
   lk->pid = 0;
-  wakeup(lk);
+  wakeupone(lk);  // only one waiter can take the lock
   release(&lk->lk);
 }
 
@@ -2,6 +2,10 @@
 struct sleeplock {
   uint locked;       // Is the lock held?
   struct spinlock lk; // spinlock protecting this sleep lock
+
+  // For lockclass.c:
+  int cls;           // lockclass(), or 0 if not looked up yet
+  uint64 tsc;        // When it was acquired
   
   // For debugging:
   char *name;        // Name of lock.
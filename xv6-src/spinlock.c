@@ -9,14 +9,72 @@
 #include "proc.h"
 #include "spinlock.h"
 
+// Pause iterations per ticket ahead of ours between polls, so
+// waiters far back in line stay off the lock's cache line.
+#define TICKETBACKOFF 16
+
+// Queue nodes for MCS locks.  A CPU holds few locks at once and
+// can't be preempted while it does, so a few nodes per CPU are
+// enough; each sits on its own cache line, as its waiter spins on it.
+#define NMCSNODE 4
+
+struct mcsnode {
+  struct mcsnode *volatile next;
+  volatile uint wait;
+} __attribute__((aligned(64)));
+
+static struct mcsnode mcsnodes[NCPU][NMCSNODE];
+static uint mcsbusy[NCPU];  // bit i set if mcsnodes[cpu][i] is in use
+
+// A ticket lock: fair, and the default.
 void
 initlock(struct spinlock *lk, char *name)
 {
   lk->name = name;
   lk->locked = 0;
+  lk->kind = LOCK_TICKET;
+  lk->next = lk->owner = 0;
+  lk->tail = 0;
+  lk->cls = 0;
   lk->cpu = 0;
 }
 
+// An MCS lock, for heavily contended locks: a waiter spins on its
+// own node rather than on the lock, which costs two extra atomic
+// operations but no cache-line traffic while it waits.
+void
+initmcslock(struct spinlock *lk, char *name)
+{
+  initlock(lk, name);
+  lk->kind = LOCK_MCS;
+}
+
+// Take a free MCS node of this CPU.  Interrupts are off.
+static struct mcsnode*
+mcsalloc(void)
+{
+  int c, i;
+
+  c = cpuid();
+  for(i = 0; i < NMCSNODE; i++){
+    if((mcsbusy[c] & (1 << i)) == 0){
+      mcsbusy[c] |= 1 << i;
+      return &mcsnodes[c][i];
+    }
+  }
+  panic("mcsalloc");
+}
+
+// Return n to this CPU, which a lock never leaves while held.
+static void
+mcsfree(struct mcsnode *n)
+{
+  int c;
+
+  c = cpuid();
+  mcsbusy[c] &= ~(1 << (n - mcsnodes[c]));
+}
+
 // Acquire the lock.
 // Loops (spins) until the lock is acquired.
 // Holding a lock for a long time may cause
@@ -24,19 +82,50 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  struct mcsnode *n, *pred;
+  uint me, ahead;
+  uint64 t0;
+  int i;
+
   pushcli(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // The xchg is atomic.
-  while(xchg(&lk->locked, 1) != 0)
-    ;
+  t0 = 0;  // set if we have to wait
+  if(lk->kind == LOCK_MCS){
+    // Queue behind the last waiter and spin until it hands over.
+    n = mcsalloc();
+    n->next = 0;
+    n->wait = 1;
+    pred = (struct mcsnode*)xchg((volatile uint*)&lk->tail, (uint)n);
+    if(pred){
+      t0 = rdtsc();
+      pred->next = n;
+      while(n->wait)
+        pause();
+    }
+    lk->node = n;
+  } else {
+    // The xadd is atomic; wait for our ticket to come up.
+    me = xadd(&lk->next, 1);
+    if(me != lk->owner)
+      t0 = rdtsc();
+    while((ahead = me - lk->owner) != 0)
+      for(i = ahead * TICKETBACKOFF; i > 0; i--)
+        pause();
+  }
+  lk->locked = 1;
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
   // references happen after the lock is acquired.
   __sync_synchronize();
 
+  lk->tsc = rdtsc();
+  if(lk->cls == 0 && lk->name)
+    lk->cls = lockclass(lk->name, 0);
+  lockcount(lk->cls, t0 != 0, lk->tsc - t0);
+
   // Record info about lock acquisition for debugging.
   lk->cpu = mycpu();
   getcallerpcs(&lk, lk->pcs);
@@ -46,11 +135,15 @@ acquire(struct spinlock *lk)
 void
 release(struct spinlock *lk)
 {
+  struct mcsnode *n;
+
   if(!holding(lk))
     panic("release");
 
+  lockhold(lk->cls, rdtsc() - lk->tsc);
   lk->pcs[0] = 0;
   lk->cpu = 0;
+  lk->locked = 0;
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that all the stores in the critical
@@ -59,14 +152,165 @@ release(struct spinlock *lk)
   // stores; __sync_synchronize() tells them both not to.
   __sync_synchronize();
 
-  // Release the lock, equivalent to lk->locked = 0.
-  // This code can't use a C assignment, since it might
-  // not be atomic. A real OS would use C atomics here.
-  asm volatile("movl $0, %0" : "+m" (lk->locked) : );
+  if(lk->kind == LOCK_MCS){
+    // Hand the lock to the next node, or mark it free if none
+    // is queued; one may be between its xchg and linking in.
+    n = lk->node;
+    if(n->next == 0 &&
+       cmpxchg((volatile uint*)&lk->tail, (uint)n, 0) != (uint)n)
+      while(n->next == 0)
+        pause();
+    if(n->next)
+      n->next->wait = 0;
+    n->next = 0;
+    mcsfree(n);
+  } else {
+    // Serve the next ticket.  Only the holder writes owner, so
+    // a plain store will do, but it must not be split.
+    asm volatile("incl %0" : "+m" (lk->owner) : );
+  }
 
   popcli();
 }
 
+#define RW_WRITER  0x80000000  // a writer holds it
+#define RW_WAITING 0x40000000  // a writer waits for the readers to leave
+
+void
+initrwlock(struct rwlock *lk, char *name)
+{
+  lk->name = name;
+  lk->cnt = 0;
+  lk->cls = 0;
+  lk->cpu = 0;
+}
+
+// Acquire lk shared with other readers.  Interrupts stay off until
+// releaseread(), as for a spin lock; don't nest reads of one lock,
+// as a writer waiting in between would deadlock.
+void
+acquireread(struct rwlock *lk)
+{
+  uint c;
+  uint64 t0;
+
+  pushcli();
+  t0 = 0;
+  for(;;){
+    c = lk->cnt;
+    if((c & (RW_WRITER | RW_WAITING)) == 0){
+      if(cmpxchg(&lk->cnt, c, c + 1) == c)
+        break;
+      continue;  // another reader got in first
+    }
+    if(t0 == 0)
+      t0 = rdtsc();
+    pause();
+  }
+  __sync_synchronize();
+
+  if(lk->cls == 0 && lk->name)
+    lk->cls = lockclass(lk->name, 0);
+  lockcount(lk->cls, t0 != 0, t0 ? rdtsc() - t0 : 0);
+}
+
+void
+releaseread(struct rwlock *lk)
+{
+  __sync_synchronize();
+  xadd(&lk->cnt, -1);
+  popcli();
+}
+
+// Acquire lk exclusively.  Announce the wait first, so that
+// readers arriving now queue behind us.
+void
+acquirewrite(struct rwlock *lk)
+{
+  uint c;
+  uint64 t0;
+
+  pushcli();
+  if((lk->cnt & RW_WRITER) && lk->cpu == mycpu())
+    panic("acquirewrite");
+  t0 = 0;
+  for(;;){
+    c = lk->cnt;
+    if((c & ~RW_WAITING) == 0){
+      if(cmpxchg(&lk->cnt, c, RW_WRITER) == c)
+        break;
+      continue;
+    }
+    if((c & RW_WAITING) == 0)
+      cmpxchg(&lk->cnt, c, c | RW_WAITING);
+    if(t0 == 0)
+      t0 = rdtsc();
+    pause();
+  }
+  __sync_synchronize();
+
+  lk->cpu = mycpu();
+  lk->tsc = rdtsc();
+  if(lk->cls == 0 && lk->name)
+    lk->cls = lockclass(lk->name, 0);
+  lockcount(lk->cls, t0 != 0, lk->tsc - t0);
+}
+
+void
+releasewrite(struct rwlock *lk)
+{
+  if(!(lk->cnt & RW_WRITER) || lk->cpu != mycpu())
+    panic("releasewrite");
+  lockhold(lk->cls, rdtsc() - lk->tsc);
+  lk->cpu = 0;
+  __sync_synchronize();
+  // Clear RW_WRITER, leaving RW_WAITING set by any other writer.
+  xadd(&lk->cnt, -RW_WRITER);
+  popcli();
+}
+
+void
+initseqlock(struct seqlock *s)
+{
+  s->seq = 0;
+}
+
+// Begin a read of the data s guards; returns the sequence to
+// pass to readseqretry().
+uint
+readseqbegin(struct seqlock *s)
+{
+  uint seq;
+
+  while((seq = s->seq) & 1)
+    pause();
+  __sync_synchronize();
+  return seq;
+}
+
+// Did a writer change the data since readseqbegin() returned seq?
+int
+readseqretry(struct seqlock *s, uint seq)
+{
+  __sync_synchronize();
+  return s->seq != seq;
+}
+
+// Writers must hold the lock that serializes them.
+void
+writeseqbegin(struct seqlock *s)
+{
+  s->seq++;
+  __sync_synchronize();
+}
+
+void
+writeseqend(struct seqlock *s)
+{
+  __sync_synchronize();
+  s->seq++;
+}
+
 // Record the current call stack in pcs[] by following the %ebp chain.
 void
 getcallerpcs(void *v, uint pcs[])
@@ -1,6 +1,25 @@
+// Kinds of spin lock; see initlock() and initmcslock().
+#define LOCK_TICKET 0  // FIFO by ticket, with proportional backoff
+#define LOCK_MCS    1  // FIFO queue, each CPU spins on its own node
+
+struct mcsnode;
+
 // Mutual exclusion lock.
 struct spinlock {
   uint locked;       // Is the lock held?
+  int kind;          // LOCK_TICKET or LOCK_MCS
+
+  // LOCK_TICKET
+  volatile uint next;   // Next ticket to hand out
+  volatile uint owner;  // Ticket now being served
+
+  // LOCK_MCS
+  struct mcsnode *volatile tail;  // Last CPU queued, or 0 if free
+  struct mcsnode *node;           // The holder's node
+
+  // For lockclass.c:
+  int cls;           // lockclass(), or 0 if not looked up yet
+  uint64 tsc;        // When it was acquired
 
   // For debugging:
   char *name;        // Name of lock.
@@ -9,3 +28,23 @@ struct spinlock {
                      // that locked the lock.
 };
 
+// Reader-writer spin lock: any number of readers, or one writer.
+// A waiting writer holds off new readers, so it can't starve.
+struct rwlock {
+  volatile uint cnt; // Readers holding it, plus RW_WRITER/RW_WAITING
+
+  // For lockclass.c:
+  int cls;           // lockclass(), or 0 if not looked up yet
+  uint64 tsc;        // When the writer acquired it
+
+  // For debugging:
+  char *name;        // Name of lock.
+  struct cpu *cpu;   // The cpu holding it for writing.
+};
+
+// Sequence lock, for data read far more often than written.
+// Writers, serialized by a lock of their own, keep seq odd while
+// they write; a reader retries if seq was odd or changed meanwhile.
+struct seqlock {
+  volatile uint seq;
+};
@@ -6,6 +6,8 @@
 #include "proc.h"
 #include "x86.h"
 #include "syscall.h"
+#include "trace.h"
+#include "syscallstat.h"
 
 // User code makes a system call with INT T_SYSCALL.
 // System call number in %eax.
@@ -13,13 +15,24 @@
 // library system call function. The saved user %esp points
 // to a saved program counter, and then the first argument.
 
+// Does [addr, addr+n) lie within the current process's heap
+// or its stack reserve?  Stack pages that are not mapped yet
+// are grown when the kernel first touches them.
+static int
+uvalid(uint addr, uint n)
+{
+  struct proc *curproc = myproc();
+
+  if(addr < curproc->sz && addr+n <= curproc->sz && addr+n >= addr)
+    return 1;
+  return addr >= USTACKBASE && addr < USTACKTOP && addr+n <= USTACKTOP;
+}
+
 // Fetch the int at addr from the current process.
 int
 fetchint(uint addr, int *ip)
 {
-  struct proc *curproc = myproc();
-
-  if(addr >= curproc->sz || addr+4 > curproc->sz)
+  if(!uvalid(addr, 4))
     return -1;
   *ip = *(int*)(addr);
   return 0;
@@ -34,10 +47,13 @@ fetchstr(uint addr, char **pp)
   char *s, *ep;
   struct proc *curproc = myproc();
 
-  if(addr >= curproc->sz)
+  if(addr < curproc->sz)
+    ep = (char*)curproc->sz;
+  else if(addr >= USTACKBASE && addr < USTACKTOP)
+    ep = (char*)USTACKTOP;
+  else
     return -1;
   *pp = (char*)addr;
-  ep = (char*)curproc->sz;
   for(s = *pp; s < ep; s++){
     if(*s == 0)
       return s - *pp;
@@ -59,11 +75,10 @@ int
 argptr(int n, char **pp, int size)
 {
   int i;
-  struct proc *curproc = myproc();
  
   if(argint(n, &i) < 0)
     return -1;
-  if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
+  if(size < 0 || !uvalid((uint)i, size))
     return -1;
   *pp = (char*)i;
   return 0;
@@ -121,6 +136,47 @@ extern int sys_unmapshared(void);
 // Part D
 extern int sys_getNumFreePages(void);
 
+// Zygote
+extern int sys_zygote(void);
+extern int sys_spawn_from(void);
+
+// Adaptive CoW
+extern int sys_getcowstat(void);
+
+// Child-runs-first fork
+extern int sys_childfirst(void);
+
+// Boot timing
+extern int sys_getbootstat(void);
+
+// MLFQ scheduler
+extern int sys_setpriority(void);
+extern int sys_getschedstat(void);
+
+// Threads
+extern int sys_clone(void);
+extern int sys_join(void);
+
+// Futexes
+extern int sys_futex_wait(void);
+extern int sys_futex_wake(void);
+
+// Lock statistics
+extern int sys_getlockstat(void);
+extern int sys_resetlockstat(void);
+
+// Profiling
+extern int sys_profstart(void);
+extern int sys_profstop(void);
+extern int sys_profread(void);
+
+// System call statistics
+extern int sys_syscallstat(void);
+
+// Resource usage
+extern int sys_getrusage(void);
+extern int sys_wait2(void);
+
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
 [SYS_exit]    sys_exit,
@@ -161,17 +217,118 @@ static int (*syscalls[])(void) = {
 
 // Part D
 [SYS_getNumFreePages] sys_getNumFreePages,
+
+// Zygote
+[SYS_zygote]  sys_zygote,
+[SYS_spawn_from] sys_spawn_from,
+
+// Adaptive CoW
+[SYS_getcowstat] sys_getcowstat,
+
+// Child-runs-first fork
+[SYS_childfirst] sys_childfirst,
+
+// Boot timing
+[SYS_getbootstat] sys_getbootstat,
+
+// MLFQ scheduler
+[SYS_setpriority] sys_setpriority,
+[SYS_getschedstat] sys_getschedstat,
+
+// Threads
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+
+// Futexes
+[SYS_futex_wait] sys_futex_wait,
+[SYS_futex_wake] sys_futex_wake,
+
+// Lock statistics
+[SYS_getlockstat]   sys_getlockstat,
+[SYS_resetlockstat] sys_resetlockstat,
+
+// Profiling
+[SYS_profstart] sys_profstart,
+[SYS_profstop]  sys_profstop,
+[SYS_profread]  sys_profread,
+
+// System call statistics
+[SYS_syscallstat] sys_syscallstat,
+
+// Resource usage
+[SYS_getrusage] sys_getrusage,
+[SYS_wait2]     sys_wait2,
 };
 
+// Per-CPU latency statistics, only updated with interrupts off.
+static struct syscallstat sysstat[NCPU][NSYSCALL];
+
+// Count a call of num that took cycles.
+static void
+syscallcount(int num, uint64 cycles)
+{
+  struct syscallstat *s;
+  uint hi, lo;
+  int b;
+
+  if(num >= NSYSCALL)
+    return;
+  hi = cycles >> 32;
+  lo = cycles;
+  if(hi)
+    b = 63 - __builtin_clz(hi);
+  else if(lo)
+    b = 31 - __builtin_clz(lo);
+  else
+    b = 0;
+  if(b >= NSYSHIST)
+    b = NSYSHIST - 1;
+
+  pushcli();
+  s = &sysstat[cpuid()][num];
+  s->calls++;
+  s->cycles += cycles;
+  s->hist[b]++;
+  popcli();
+}
+
+// Copy the statistics of system calls 0..n-1, summed over CPUs,
+// to st.  Returns the number copied.
+int
+syscallstat(struct syscallstat *st, int n)
+{
+  struct syscallstat s, *cs;
+  int i, c, b;
+
+  for(i = 0; i < NSYSCALL && i < n; i++){
+    memset(&s, 0, sizeof(s));
+    for(c = 0; c < ncpu; c++){
+      cs = &sysstat[c][i];
+      s.calls += cs->calls;
+      s.cycles += cs->cycles;
+      for(b = 0; b < NSYSHIST; b++)
+        s.hist[b] += cs->hist[b];
+    }
+    st[i] = s;
+  }
+  return i;
+}
+
 void
 syscall(void)
 {
   int num;
+  uint64 t0;
   struct proc *curproc = myproc();
 
+  vmsync(curproc);  // another thread may have resized memory
   num = curproc->tf->eax;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
+    t0 = rdtsc();
     curproc->tf->eax = syscalls[num]();
+    t0 = rdtsc() - t0;
+    syscallcount(num, t0);
+    trace(TR_SYSCALL, num, curproc->tf->eax, t0, 0);
   } else {
     cprintf("%d %s: unknown sys call %d\n",
             curproc->pid, curproc->name, num);
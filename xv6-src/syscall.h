@@ -36,3 +36,44 @@
 
 // Part D
 #define SYS_getNumFreePages 29
+
+// Zygote
+#define SYS_zygote 30
+#define SYS_spawn_from 31
+
+// Adaptive CoW
+#define SYS_getcowstat 32
+
+// Child-runs-first fork
+#define SYS_childfirst 33
+
+// Boot timing
+#define SYS_getbootstat 34
+
+// MLFQ scheduler
+#define SYS_setpriority 35
+#define SYS_getschedstat 36
+
+// Threads
+#define SYS_clone 37
+#define SYS_join 38
+
+// Futexes
+#define SYS_futex_wait 39
+#define SYS_futex_wake 40
+
+// Lock statistics
+#define SYS_getlockstat 41
+#define SYS_resetlockstat 42
+
+// Profiling
+#define SYS_profstart 43
+#define SYS_profstop  44
+#define SYS_profread  45
+
+// System call statistics
+#define SYS_syscallstat 46
+
+// Resource usage
+#define SYS_getrusage 47
+#define SYS_wait2     48
@@ -0,0 +1,161 @@
+// Print system call latency statistics.
+//   syscallstat [-v]            counts since boot
+//   syscallstat [-v] cmd args   counts while cmd runs
+// Latencies are in TSC cycles; p50, p99 and max give the log2
+// histogram bucket, so p99 12 means under 2^13 cycles.  -v also
+// prints the histograms.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "syscall.h"
+#include "syscallstat.h"
+
+char *names[NSYSCALL] = {
+[SYS_fork]    "fork",
+[SYS_exit]    "exit",
+[SYS_wait]    "wait",
+[SYS_pipe]    "pipe",
+[SYS_read]    "read",
+[SYS_kill]    "kill",
+[SYS_exec]    "exec",
+[SYS_fstat]   "fstat",
+[SYS_chdir]   "chdir",
+[SYS_dup]     "dup",
+[SYS_getpid]  "getpid",
+[SYS_sbrk]    "sbrk",
+[SYS_sleep]   "sleep",
+[SYS_uptime]  "uptime",
+[SYS_open]    "open",
+[SYS_write]   "write",
+[SYS_mknod]   "mknod",
+[SYS_unlink]  "unlink",
+[SYS_link]    "link",
+[SYS_mkdir]   "mkdir",
+[SYS_close]   "close",
+[SYS_numvp]   "numvp",
+[SYS_numpp]   "numpp",
+[SYS_getptsize] "getptsize",
+[SYS_mmap]    "mmap",
+[SYS_mapshared]   "mapshared",
+[SYS_getshared]   "getshared",
+[SYS_unmapshared] "unmapshared",
+[SYS_getNumFreePages] "getNumFreePages",
+[SYS_zygote]      "zygote",
+[SYS_spawn_from]  "spawn_from",
+[SYS_getcowstat]  "getcowstat",
+[SYS_childfirst]  "childfirst",
+[SYS_getbootstat] "getbootstat",
+[SYS_setpriority]  "setpriority",
+[SYS_getschedstat] "getschedstat",
+[SYS_clone]   "clone",
+[SYS_join]    "join",
+[SYS_futex_wait] "futex_wait",
+[SYS_futex_wake] "futex_wake",
+[SYS_getlockstat]   "getlockstat",
+[SYS_resetlockstat] "resetlockstat",
+[SYS_profstart] "profstart",
+[SYS_profstop]  "profstop",
+[SYS_profread]  "profread",
+[SYS_syscallstat] "syscallstat",
+[SYS_getrusage] "getrusage",
+[SYS_wait2]     "wait2",
+};
+
+struct syscallstat before[NSYSCALL], after[NSYSCALL];
+
+// Mean of n calls taking cycles in all, without 64-bit division.
+uint
+mean(uint64 cycles, uint n)
+{
+  int shift;
+
+  for(shift = 0; cycles >> 32; shift++)
+    cycles >>= 1;
+  return ((uint)cycles / n) << shift;
+}
+
+// The bucket holding the call at fraction pct of s's calls.
+int
+bucket(struct syscallstat *s, int pct)
+{
+  uint sum, want;
+  int b;
+
+  want = s->calls - s->calls * (100 - pct) / 100;
+  sum = 0;
+  for(b = 0; b < NSYSHIST; b++){
+    sum += s->hist[b];
+    if(sum >= want && sum > 0)
+      return b;
+  }
+  return NSYSHIST - 1;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, j, b, n, pid, verbose, order[NSYSCALL];
+  struct syscallstat *s;
+
+  verbose = 0;
+  if(argc > 1 && strcmp(argv[1], "-v") == 0){
+    verbose = 1;
+    argc--;
+    argv++;
+  }
+
+  memset(before, 0, sizeof(before));
+  if(argc > 1){
+    syscallstat(before, NSYSCALL);
+    pid = fork();
+    if(pid < 0){
+      printf(2, "syscallstat: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      exec(argv[1], argv+1);
+      printf(2, "syscallstat: exec %s failed\n", argv[1]);
+      exit();
+    }
+    wait();
+  }
+  n = syscallstat(after, NSYSCALL);
+
+  for(i = 0; i < n; i++){
+    s = &after[i];
+    s->calls -= before[i].calls;
+    s->cycles -= before[i].cycles;
+    for(b = 0; b < NSYSHIST; b++)
+      s->hist[b] -= before[i].hist[b];
+    order[i] = i;
+  }
+
+  // Most cycles first.
+  for(i = 0; i < n; i++)
+    for(j = i+1; j < n; j++)
+      if(after[order[j]].cycles > after[order[i]].cycles){
+        b = order[i];
+        order[i] = order[j];
+        order[j] = b;
+      }
+
+  printf(1, "%s\t%s\t%s\t%s\t%s\t%s\n", "syscall", "calls", "mean",
+         "p50", "p99", "max");
+  for(i = 0; i < n; i++){
+    s = &after[order[i]];
+    if(s->calls == 0)
+      continue;
+    for(b = NSYSHIST - 1; b > 0 && s->hist[b] == 0; b--)
+      ;
+    printf(1, "%s\t%d\t%d\t%d\t%d\t%d\n",
+           names[order[i]] ? names[order[i]] : "?", s->calls,
+           mean(s->cycles, s->calls), bucket(s, 50), bucket(s, 99), b);
+    if(verbose){
+      for(b = 0; b < NSYSHIST; b++)
+        if(s->hist[b])
+          printf(1, "\t2^%d\t%d\n", b, s->hist[b]);
+    }
+  }
+  exit();
+}
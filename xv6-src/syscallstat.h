@@ -0,0 +1,11 @@
+#define NSYSCALL 64  // system call numbers counted
+#define NSYSHIST 32  // latency histogram buckets
+
+// Latency of one system call, summed over CPUs, returned by
+// syscallstat().  hist[i] counts the calls that took 2^i to
+// 2^(i+1)-1 TSC cycles; the last bucket also holds slower ones.
+struct syscallstat {
+  uint calls;
+  uint64 cycles;     // total over all calls
+  uint hist[NSYSHIST];
+};
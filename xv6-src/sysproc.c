@@ -6,6 +6,14 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "cowstat.h"
+#include "bootstat.h"
+#include "ktimer.h"
+#include "schedstat.h"
+#include "lockstat.h"
+#include "prof.h"
+#include "syscallstat.h"
+#include "rusage.h"
 
 int
 sys_fork(void)
@@ -50,8 +58,7 @@ sys_sbrk(void)
 
   if(argint(0, &n) < 0)
     return -1;
-  addr = myproc()->sz;
-  if(growproc(n) < 0)
+  if((addr = growproc(n)) < 0)
     return -1;
   return addr;
 }
@@ -61,18 +68,26 @@ sys_sleep(void)
 {
   int n;
   uint ticks0;
+  struct ktimer t;
 
   if(argint(0, &n) < 0)
     return -1;
+  if(n <= 0)
+    return 0;
   acquire(&tickslock);
   ticks0 = ticks;
+  ktimerset(&t, n);
   while(ticks - ticks0 < n){
     if(myproc()->killed){
+      if(ktimercancel(&t))
+        untimeout();
       release(&tickslock);
       return -1;
     }
-    sleep(&ticks, &tickslock);
+    sleep(&t, &tickslock);
   }
+  if(ktimercancel(&t))
+    untimeout();
   release(&tickslock);
   return 0;
 }
@@ -82,11 +97,12 @@ sys_sleep(void)
 int
 sys_uptime(void)
 {
-  uint xticks;
+  uint xticks, seq;
 
-  acquire(&tickslock);
-  xticks = ticks;
-  release(&tickslock);
+  do {
+    seq = readseqbegin(&tickseq);
+    xticks = ticks;
+  } while(readseqretry(&tickseq, seq));
   return xticks;
 }
 
@@ -123,9 +139,15 @@ sys_mmap(void)
   if(n <= 0 || (n % PGSIZE) != 0)
     return 0; 
 
+  vmlock(curproc);
   oldsz = curproc->sz;
+  if(n > USTACKBASE - oldsz){
+    vmunlock(curproc);
+    return 0;
+  }
 
   curproc->sz = oldsz + n;
+  vmunlock(curproc);
   
   return oldsz;
 }
@@ -157,3 +179,217 @@ sys_getNumFreePages(void)
 {
   return getNumFreePages();
 }
+
+// Zygote
+
+int
+sys_zygote(void)
+{
+  return zygote();
+}
+
+int
+sys_spawn_from(void)
+{
+  int pid, entry;
+
+  if(argint(0, &pid) < 0 || argint(1, &entry) < 0)
+    return -1;
+  return spawn(pid, (uint)entry);
+}
+
+// Adaptive CoW
+
+int
+sys_getcowstat(void)
+{
+  struct cowstat *st;
+
+  if(argptr(0, (void*)&st, sizeof(*st)) < 0)
+    return -1;
+  getcowstat(st);
+  return 0;
+}
+
+// Child-runs-first fork
+
+int
+sys_childfirst(void)
+{
+  int on;
+
+  if(argint(0, &on) < 0)
+    return -1;
+  return setchildfirst(on);
+}
+
+// Boot timing
+
+int
+sys_getbootstat(void)
+{
+  struct bootstat *st;
+
+  if(argptr(0, (void*)&st, sizeof(*st)) < 0)
+    return -1;
+  getbootstat(st);
+  return 0;
+}
+
+// MLFQ scheduler
+
+int
+sys_setpriority(void)
+{
+  int pid, nice;
+
+  if(argint(0, &pid) < 0 || argint(1, &nice) < 0)
+    return -1;
+  return setpriority(pid, nice);
+}
+
+int
+sys_getschedstat(void)
+{
+  int pid;
+  struct schedstat *st;
+
+  if(argint(0, &pid) < 0 || argptr(1, (void*)&st, sizeof(*st)) < 0)
+    return -1;
+  return getschedstat(pid, st);
+}
+
+// Threads
+int
+sys_clone(void)
+{
+  int fn, stack, arg;
+
+  if(argint(0, &fn) < 0 || argint(1, &stack) < 0 || argint(2, &arg) < 0)
+    return -1;
+  return clone(fn, stack, arg);
+}
+
+// The stack is stored after join() returns: the store may take a
+// CoW fault, which must not happen under ptable.lock.
+int
+sys_join(void)
+{
+  uint *stack, ustack;
+  int pid;
+
+  if(argptr(0, (void*)&stack, sizeof(*stack)) < 0)
+    return -1;
+  if((pid = join(&ustack)) >= 0)
+    *stack = ustack;
+  return pid;
+}
+
+// Futexes
+int
+sys_futex_wait(void)
+{
+  int addr, val;
+
+  if(argint(0, &addr) < 0 || argint(1, &val) < 0)
+    return -1;
+  return futexwait(addr, val);
+}
+
+int
+sys_futex_wake(void)
+{
+  int addr, n;
+
+  if(argint(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  return futexwake(addr, n);
+}
+
+// Lock statistics
+int
+sys_getlockstat(void)
+{
+  int n;
+  struct lockstat *st;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NLOCKCLASS ||
+     argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return getlockstat(st, n);
+}
+
+int
+sys_resetlockstat(void)
+{
+  resetlockstat();
+  return 0;
+}
+
+// Profiling
+int
+sys_profstart(void)
+{
+  int period;
+
+  if(argint(0, &period) < 0)
+    return -1;
+  return profstart(period);
+}
+
+int
+sys_profstop(void)
+{
+  return profstop();
+}
+
+int
+sys_profread(void)
+{
+  int n;
+  struct profsample *buf;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NCPU*NPROFSAMPLE ||
+     argptr(0, (void*)&buf, n*sizeof(*buf)) < 0)
+    return -1;
+  return profread((uint)buf, n);
+}
+
+// System call statistics
+int
+sys_syscallstat(void)
+{
+  int n;
+  struct syscallstat *st;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NSYSCALL ||
+     argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return syscallstat(st, n);
+}
+
+// Resource usage
+int
+sys_getrusage(void)
+{
+  int pid;
+  struct rusage *ru;
+
+  if(argint(0, &pid) < 0 || argptr(1, (void*)&ru, sizeof(*ru)) < 0)
+    return -1;
+  return getrusage(pid, ru);
+}
+
+int
+sys_wait2(void)
+{
+  int pid;
+  struct rusage *ru, r;
+
+  if(argptr(0, (void*)&ru, sizeof(*ru)) < 0)
+    return -1;
+  // wait2() fills r under ptable.lock; copy it out afterwards.
+  if((pid = wait2(&r)) >= 0)
+    *ru = r;
+  return pid;
+}
@@ -0,0 +1,84 @@
+// Test program for running the child first after fork
+// Tests that with childfirst on, fork+exec lets the child drop its
+// CoW references before the parent writes, so fewer pages are copied
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "cowstat.h"
+
+#define PGSIZE 4096
+#define NPAGES 16
+#define NROUNDS 8
+
+char *args[] = { "test_childfirst", "child", 0 };
+
+// Fork+exec NROUNDS times, writing NPAGES freshly allocated pages in
+// the parent right after each fork.  Returns the CoW copies made.
+int copies(int on) {
+    struct cowstat before, after;
+    char *buf;
+    int i, j, pid;
+
+    childfirst(on);
+    getcowstat(&before);
+    for (i = 0; i < NROUNDS; i++) {
+        // New pages each round, so they are not hot and copied
+        // eagerly at fork.
+        buf = sbrk(NPAGES * PGSIZE);
+        if (buf == (char*)-1) {
+            printf(1, "ERROR: sbrk failed!\n");
+            exit();
+        }
+        for (j = 0; j < NPAGES; j++)
+            buf[j*PGSIZE] = 'a';
+
+        pid = fork();
+        if (pid < 0) {
+            printf(1, "ERROR: fork failed!\n");
+            exit();
+        }
+        if (pid == 0) {
+            exec("test_childfirst", args);
+            printf(1, "ERROR: exec failed!\n");
+            exit();
+        }
+        for (j = 0; j < NPAGES; j++)
+            buf[j*PGSIZE] = 'b';
+        wait();
+        sbrk(-NPAGES * PGSIZE);
+    }
+    getcowstat(&after);
+    return after.copies - before.copies;
+}
+
+int main(int argc, char *argv[]) {
+    int old, off, on;
+
+    if (argc > 1)
+        exit();
+
+    printf(1, "Child-First Fork Test\n");
+    printf(1, "=====================\n");
+
+    // Warm the buffer cache, so exec doesn't wait for the disk.
+    old = childfirst(0);
+    copies(0);
+
+    printf(1, "\nFork+exec %d times, parent writing %d pages after each...\n",
+           NROUNDS, NPAGES);
+    off = copies(0);
+    on = copies(1);
+    childfirst(old);
+
+    printf(1, "CoW copies, childfirst off: %d\n", off);
+    printf(1, "CoW copies, childfirst on:  %d\n", on);
+    if (on < off) {
+        printf(1, "✓ PASS: Running the child first avoided copies\n");
+    } else {
+        printf(1, "✗ FAIL: Expected fewer copies with childfirst on\n");
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
@@ -15,6 +15,10 @@ int main(int argc, char *argv[]) {
     printf(1, "Part D: Copy-on-Write Fork Test\n");
     printf(1, "================================\n");
     
+    // Let idle CPUs free the address spaces of exited processes,
+    // which would change the free page count under us.
+    sleep(1);
+
     // Allocate some memory before fork
     printf(1, "\nAllocating 3 pages before fork...\n");
     char *mem = sbrk(3 * PGSIZE);
@@ -0,0 +1,92 @@
+// Test program for the sampling profiler
+// Tests that timer samples record this process in user and kernel
+// mode and that profread() drains them
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "prof.h"
+
+#define KERNBASE 0x80000000
+#define NTICKS 50
+
+struct profsample samples[NCPU*NPROFSAMPLE];
+
+int main(int argc, char *argv[]) {
+    int i, n, start, mine, user, kernel, bad;
+    volatile int x = 0;
+    uint sz = (uint)sbrk(0);
+
+    printf(1, "Sampling Profiler Test\n");
+    printf(1, "======================\n");
+
+    if (profstart(0) < 0) {
+        printf(1, "✓ PASS: A period of 0 is rejected\n");
+    } else {
+        printf(1, "✗ FAIL: profstart(0) succeeded\n");
+    }
+
+    printf(1, "\nSpinning for %d ticks, half in system calls...\n", NTICKS);
+    if (profstart(1) < 0) {
+        printf(1, "ERROR: profstart failed!\n");
+        exit();
+    }
+    start = uptime();
+    while (uptime() - start < NTICKS) {
+        for (i = 0; i < 10000; i++)
+            x++;
+        for (i = 0; i < 100; i++)
+            getpid();
+    }
+    profstop();
+
+    n = profread(samples, NCPU*NPROFSAMPLE);
+    mine = user = kernel = bad = 0;
+    for (i = 0; i < n; i++) {
+        if (samples[i].pid != getpid())
+            continue;
+        mine++;
+        if (strcmp(samples[i].name, "test_prof") != 0)
+            bad = 1;
+        if (samples[i].user) {
+            user++;
+            if (samples[i].eip >= sz)
+                bad = 1;
+        } else {
+            kernel++;
+            if (samples[i].eip < KERNBASE)
+                bad = 1;
+        }
+    }
+    printf(1, "Samples: %d, ours: %d (user %d, kernel %d)\n",
+           n, mine, user, kernel);
+
+    if (mine >= NTICKS / 2) {
+        printf(1, "✓ PASS: Timer interrupts sampled this process\n");
+    } else {
+        printf(1, "✗ FAIL: Expected at least %d samples\n", NTICKS / 2);
+    }
+
+    if (user > 0 && kernel > 0) {
+        printf(1, "✓ PASS: Both user and kernel samples were taken\n");
+    } else {
+        printf(1, "✗ FAIL: Missing user or kernel samples\n");
+    }
+
+    if (!bad) {
+        printf(1, "✓ PASS: Sample addresses and names match the mode\n");
+    } else {
+        printf(1, "✗ FAIL: A sample has a bad address or name\n");
+    }
+
+    sleep(5);
+    if (profread(samples, NCPU*NPROFSAMPLE) == 0) {
+        printf(1, "✓ PASS: Samples were drained and sampling stopped\n");
+    } else {
+        printf(1, "✗ FAIL: Samples left after profstop and profread\n");
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
@@ -0,0 +1,149 @@
+// Test program for the per-CPU run queue locks
+// Tests that idle CPUs no longer take ptable.lock to look for work,
+// and measures pipe ping-pong between many processes.  Run with
+// make qemu CPUS=8 to see the contention on 8 CPUs.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "bootstat.h"
+#include "lockstat.h"
+
+#define NPAIRS 16
+#define IDLETICKS 50
+#define RUNTICKS 100
+
+struct lockstat st[NLOCKCLASS];
+
+// Find the spin lock class name, or return 0.
+struct lockstat *find(char *name) {
+    int i, n;
+
+    n = getlockstat(st, NLOCKCLASS);
+    for (i = 0; i < n; i++)
+        if (!st[i].sleep && strcmp(st[i].name, name) == 0)
+            return &st[i];
+    return 0;
+}
+
+// Bounce a byte off the other end of the pair until the deadline,
+// then report the round trips on out.
+void pinger(int wfd, int rfd, int out, int end) {
+    char c = 'x';
+    int n = 0;
+
+    while (uptime() < end) {
+        if (write(wfd, &c, 1) != 1 || read(rfd, &c, 1) != 1)
+            break;
+        n++;
+    }
+    close(wfd);
+    write(out, &n, sizeof n);
+    exit();
+}
+
+// Echo bytes back until the pinger closes its end.
+void ponger(int rfd, int wfd) {
+    char c;
+
+    while (read(rfd, &c, 1) == 1)
+        write(wfd, &c, 1);
+    exit();
+}
+
+int main(int argc, char *argv[]) {
+    struct bootstat bs;
+    struct lockstat *ls;
+    int ping[2], pong[2], res[2];
+    int i, n, total, idle, ncpu, start, end, ticks, stalled;
+
+    printf(1, "Run Queue Lock Test\n");
+    printf(1, "===================\n");
+
+    ncpu = 0;
+    if (getbootstat(&bs) == 0)
+        ncpu = bs.ncpu;
+    printf(1, "CPUs: %d\n", ncpu);
+
+    // Idle: only this process sleeping, the other CPUs looking
+    // for work.
+    printf(1, "\nSleeping %d ticks...\n", IDLETICKS);
+    resetlockstat();
+    sleep(IDLETICKS);
+    ls = find("ptable");
+    idle = ls ? ls->acquires : -1;
+    printf(1, "ptable acquisitions while idle: %d\n", idle);
+    if (idle >= 0 && idle < IDLETICKS * 20) {
+        printf(1, "✓ PASS: Idle CPUs leave ptable.lock alone\n");
+    } else {
+        printf(1, "✗ FAIL: Expected fewer than %d acquisitions\n",
+               IDLETICKS * 20);
+    }
+
+    // Busy: NPAIRS pairs of processes ping-ponging over pipes.
+    printf(1, "\nRunning %d ping-pong pairs for %d ticks...\n",
+           NPAIRS, RUNTICKS);
+    if (pipe(res) < 0) {
+        printf(1, "ERROR: pipe failed!\n");
+        exit();
+    }
+    resetlockstat();
+    start = uptime();
+    end = start + RUNTICKS;
+    for (i = 0; i < NPAIRS; i++) {
+        if (pipe(ping) < 0 || pipe(pong) < 0) {
+            printf(1, "ERROR: pipe failed!\n");
+            exit();
+        }
+        if (fork() == 0) {
+            close(ping[0]);
+            close(pong[1]);
+            close(res[0]);
+            pinger(ping[1], pong[0], res[1], end);
+        }
+        if (fork() == 0) {
+            close(ping[1]);
+            close(pong[0]);
+            close(res[0]);
+            close(res[1]);
+            ponger(ping[0], pong[1]);
+        }
+        close(ping[0]);
+        close(ping[1]);
+        close(pong[0]);
+        close(pong[1]);
+    }
+    close(res[1]);
+
+    total = 0;
+    stalled = 0;
+    for (i = 0; i < NPAIRS; i++) {
+        if (read(res[0], &n, sizeof n) != sizeof n)
+            n = 0;
+        if (n == 0)
+            stalled++;
+        total += n;
+    }
+    close(res[0]);
+    for (i = 0; i < 2 * NPAIRS; i++)
+        wait();
+    ticks = uptime() - start;
+
+    printf(1, "round trips: %d in %d ticks (%d per tick)\n",
+           total, ticks, ticks > 0 ? total / ticks : 0);
+    if ((ls = find("ptable")) != 0)
+        printf(1, "ptable: %d acquires, %d contended\n",
+               ls->acquires, ls->contended);
+    if ((ls = find("runq")) != 0)
+        printf(1, "runq:   %d acquires, %d contended\n",
+               ls->acquires, ls->contended);
+    if (stalled == 0) {
+        printf(1, "✓ PASS: All %d pairs made progress\n", NPAIRS);
+    } else {
+        printf(1, "✗ FAIL: %d pairs made no progress\n", stalled);
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
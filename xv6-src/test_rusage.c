@@ -0,0 +1,103 @@
+// Test program for resource usage accounting
+// Tests that getrusage() and wait2() report CPU ticks, page faults,
+// context switches and disk writes of a process
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "rusage.h"
+
+#define PGSIZE 4096
+#define NPAGES 8
+#define NTICKS 20
+
+char page[PGSIZE];
+
+int main(int argc, char *argv[]) {
+    struct rusage before, after, ru;
+    int i, pid, start, fd;
+    volatile int x = 0;
+    char *mem;
+
+    printf(1, "Resource Usage Test\n");
+    printf(1, "===================\n");
+
+    if (getrusage(-1, &ru) < 0) {
+        printf(1, "✓ PASS: getrusage of a bad pid fails\n");
+    } else {
+        printf(1, "✗ FAIL: getrusage(-1) succeeded\n");
+    }
+
+    printf(1, "\nSpinning in user mode for %d ticks...\n", NTICKS);
+    getrusage(0, &before);
+    start = uptime();
+    while (uptime() - start < NTICKS)
+        for (i = 0; i < 10000; i++)
+            x++;
+    getrusage(getpid(), &after);
+    printf(1, "user ticks: %d, system ticks: %d\n",
+           after.utime - before.utime, after.stime - before.stime);
+    if (after.utime - before.utime >= NTICKS / 2) {
+        printf(1, "✓ PASS: User time was charged\n");
+    } else {
+        printf(1, "✗ FAIL: Expected at least %d user ticks\n", NTICKS / 2);
+    }
+
+    printf(1, "\nChild: CoW write, %d zero-fill pages, sleep, file write...\n",
+           NPAGES);
+    page[0] = 1;
+    pid = fork();
+    if (pid < 0) {
+        printf(1, "ERROR: fork failed!\n");
+        exit();
+    }
+    if (pid == 0) {
+        page[0] = 2;
+        if ((mem = mmap(NPAGES * PGSIZE)) != 0)
+            for (i = 0; i < NPAGES; i++)
+                mem[i * PGSIZE] = 1;
+        sleep(1);
+        if ((fd = open("rusagetmp", O_CREATE | O_RDWR)) >= 0) {
+            write(fd, page, sizeof(page));
+            close(fd);
+        }
+        unlink("rusagetmp");
+        exit();
+    }
+    if (wait2(&ru) != pid) {
+        printf(1, "✗ FAIL: wait2 did not return the child\n");
+        exit();
+    }
+    printf(1, "faults %d (cow %d, zero-fill %d), switches %d+%d, blocks %d+%d\n",
+           ru.minflt, ru.cowflt, ru.zfill, ru.nvcsw, ru.nivcsw,
+           ru.inblock, ru.oublock);
+
+    if (ru.cowflt >= 1 && ru.zfill >= NPAGES &&
+        ru.minflt >= ru.cowflt + ru.zfill) {
+        printf(1, "✓ PASS: Child's page faults were counted\n");
+    } else {
+        printf(1, "✗ FAIL: Page fault counts are wrong\n");
+    }
+
+    if (ru.nvcsw >= 1) {
+        printf(1, "✓ PASS: Child's sleep counted as a voluntary switch\n");
+    } else {
+        printf(1, "✗ FAIL: No voluntary context switches\n");
+    }
+
+    if (ru.oublock >= 1) {
+        printf(1, "✓ PASS: Child's disk writes were counted\n");
+    } else {
+        printf(1, "✗ FAIL: No blocks written\n");
+    }
+
+    if (wait2(&ru) < 0) {
+        printf(1, "✓ PASS: wait2 with no children fails\n");
+    } else {
+        printf(1, "✗ FAIL: wait2 returned a child\n");
+    }
+
+    printf(1, "\nTest completed!\n");
+    exit();
+}
@@ -0,0 +1,168 @@
+// Shared program text cache.
+//
+// exec() used to read a private copy of every program page, so ten
+// copies of sh cost ten copies of its code.  The text cache keeps one
+// physical page per (inode, offset) of a program file and exec() maps
+// that same page, read-only, into every process running the binary.
+// A process that writes such a page (its data lives in the same
+// segment for our -N linked binaries) takes the ordinary CoW fault and
+// gets a private copy, so the cached page is never modified.
+//
+// Interface:
+// * textpage() returns a cached page for (ip, off) with a reference
+//   held for the caller, filling the cache on a miss.
+// * textinval() drops the pages of an inode whose content changes.
+//
+// An inode with cached pages carries I_TEXT, so writes to inodes that
+// were never exec'd skip textinval()'s scan and tcache.lock.  ilock()
+// sets the flag again, through textcached(), when it rereads an inode
+// whose pages outlived its inode cache entry.
+//
+// The cache holds one reference (kalloc.c ref counts) on each of its
+// pages.  Entries that nobody else maps (ref count 1) are recycled
+// when the table is full.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "stat.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+
+#define NTEXTPAGE 128
+
+struct textpage {
+  uint dev;
+  uint inum;
+  uint off;     // file offset of the page contents
+  uint n;       // bytes of file data; the rest is zero
+  char *mem;    // 0 if the slot is free
+};
+
+struct {
+  struct spinlock lock;
+  struct textpage page[NTEXTPAGE];
+  int hand;     // next slot to consider for recycling
+} tcache;
+
+void
+textinit(void)
+{
+  initlock(&tcache.lock, "textcache");
+}
+
+// Find a free slot, recycling one that only the cache maps.
+// Caller must hold tcache.lock.
+static struct textpage*
+textslot(void)
+{
+  struct textpage *t;
+  int i;
+
+  for(t = tcache.page; t < &tcache.page[NTEXTPAGE]; t++)
+    if(t->mem == 0)
+      return t;
+
+  for(i = 0; i < NTEXTPAGE; i++){
+    t = &tcache.page[tcache.hand];
+    tcache.hand = (tcache.hand + 1) % NTEXTPAGE;
+    if(get_ref(t->mem) == 1){
+      kfree(t->mem);
+      t->mem = 0;
+      return t;
+    }
+  }
+  return 0;
+}
+
+// Return a page holding n bytes of ip's content at off followed by
+// zeros, with a reference held for the caller.  Returns 0 if the page
+// cannot be cached; the caller should then load a private copy.
+// Caller must hold ip->lock, which also keeps other execs of the same
+// file from filling the same entry concurrently.
+char*
+textpage(struct inode *ip, uint off, uint n)
+{
+  struct textpage *t;
+  char *mem;
+
+  if(ip->type == T_DEV || n == 0 || n > PGSIZE)
+    return 0;
+
+  acquire(&tcache.lock);
+  for(t = tcache.page; t < &tcache.page[NTEXTPAGE]; t++){
+    if(t->mem && t->dev == ip->dev && t->inum == ip->inum &&
+       t->off == off && t->n == n){
+      inc_ref(t->mem);
+      release(&tcache.lock);
+      ip->flags |= I_TEXT;
+      return t->mem;
+    }
+  }
+  release(&tcache.lock);
+
+  // Not cached; readi may sleep, so read without tcache.lock.
+  if((mem = kalloc()) == 0)
+    return 0;
+  if(readi(ip, mem, off, n) != n){
+    kfree(mem);
+    return 0;
+  }
+  memset(mem + n, 0, PGSIZE - n);
+
+  acquire(&tcache.lock);
+  if((t = textslot()) == 0){
+    // Every cached page is in use; hand out a private copy.
+    release(&tcache.lock);
+    return mem;
+  }
+  t->dev = ip->dev;
+  t->inum = ip->inum;
+  t->off = off;
+  t->n = n;
+  t->mem = mem;
+  inc_ref(mem);
+  release(&tcache.lock);
+  ip->flags |= I_TEXT;
+  return mem;
+}
+
+// Return 1 if the cache holds pages of ip.
+int
+textcached(struct inode *ip)
+{
+  struct textpage *t;
+  int found;
+
+  found = 0;
+  acquire(&tcache.lock);
+  for(t = tcache.page; t < &tcache.page[NTEXTPAGE]; t++)
+    if(t->mem && t->dev == ip->dev && t->inum == ip->inum)
+      found = 1;
+  release(&tcache.lock);
+  return found;
+}
+
+// Forget the cached pages of ip, whose content is changing.
+// Processes already running the old text keep their references.
+// Caller must hold ip->lock.
+void
+textinval(struct inode *ip)
+{
+  struct textpage *t;
+
+  if((ip->flags & I_TEXT) == 0)
+    return;
+  ip->flags &= ~I_TEXT;
+  acquire(&tcache.lock);
+  for(t = tcache.page; t < &tcache.page[NTEXTPAGE]; t++){
+    if(t->mem && t->dev == ip->dev && t->inum == ip->inum){
+      kfree(t->mem);
+      t->mem = 0;
+    }
+  }
+  release(&tcache.lock);
+}
@@ -0,0 +1,51 @@
+// Run a command and print the time and resources it used.
+//   time cmd args
+// Times are in timer ticks, 100 a second.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "rusage.h"
+
+// Print ticks as seconds.
+void
+secs(char *what, uint t)
+{
+  printf(2, "%s %d.%d%ds", what, t / 100, t / 10 % 10, t % 10);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid, start;
+  struct rusage ru;
+
+  if(argc < 2){
+    printf(2, "usage: time cmd args\n");
+    exit();
+  }
+
+  start = uptime();
+  pid = fork();
+  if(pid < 0){
+    printf(2, "time: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(argv[1], argv+1);
+    printf(2, "time: exec %s failed\n", argv[1]);
+    exit();
+  }
+  if(wait2(&ru) < 0){
+    printf(2, "time: wait2 failed\n");
+    exit();
+  }
+
+  secs("real", uptime() - start);
+  secs(" user", ru.utime);
+  secs(" sys", ru.stime);
+  printf(2, "\n%d faults (%d cow, %d zero-fill), %d+%d switches, "
+         "%d+%d blocks\n", ru.minflt, ru.cowflt, ru.zfill, ru.nvcsw,
+         ru.nivcsw, ru.inblock, ru.oublock);
+  exit();
+}
@@ -0,0 +1,112 @@
+// Print kernel trace events.
+//   trace            print the events buffered in /trace
+//   trace cmd args   trace while cmd runs, then print the events
+// Events are sorted by TSC; times are in thousands of cycles from
+// the first event.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "param.h"
+#include "trace.h"
+
+#define NEV (NCPU*NTRACE + NCPU)
+
+struct traceev ev[NEV];
+
+char *states[] = { "unused", "embryo", "sleep", "runble", "run", "zombie" };
+
+void
+print(struct traceev *e, uint64 t0)
+{
+  printf(1, "%d\t%d\t%d\t", (uint)((e->tsc - t0) >> 10), e->cpu, e->pid);
+  switch(e->type){
+  case TR_SYSCALL:
+    printf(1, "syscall %d = %d, %d cycles\n", e->arg[0], e->arg[1], e->arg[2]);
+    break;
+  case TR_PGFLT:
+    printf(1, "pgflt 0x%x err %d, %d cycles%s\n", e->arg[0], e->arg[1],
+           e->arg[2], e->arg[3] ? ", killed" : "");
+    break;
+  case TR_SWTCHOUT:
+    printf(1, "switch out, %s", e->arg[0] < sizeof(states)/sizeof(states[0]) ?
+           states[e->arg[0]] : "?");
+    if(e->arg[1])
+      printf(1, " on 0x%x", e->arg[1]);
+    printf(1, "\n");
+    break;
+  case TR_SWTCHIN:
+    printf(1, "switch in, level %d\n", e->arg[0]);
+    break;
+  case TR_DISK:
+    printf(1, "disk %s block %d, %d cycles\n", e->arg[1] ? "write" : "read",
+           e->arg[0], e->arg[2]);
+    break;
+  case TR_COMMIT:
+    printf(1, "commit %d blocks, %d cycles\n", e->arg[0], e->arg[1]);
+    break;
+  default:
+    printf(1, "event %d\n", e->type);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd, pid, n, i, j, gap, lost;
+  struct traceev t;
+
+  if((fd = open("trace", O_RDWR)) < 0){
+    printf(2, "trace: cannot open /trace\n");
+    exit();
+  }
+
+  if(argc > 1){
+    write(fd, "1", 1);
+    pid = fork();
+    if(pid < 0){
+      printf(2, "trace: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      close(fd);
+      exec(argv[1], argv+1);
+      printf(2, "trace: exec %s failed\n", argv[1]);
+      exit();
+    }
+    wait();
+    write(fd, "0", 1);
+  }
+
+  for(n = 0; n < NEV; n += i / sizeof(ev[0]))
+    if((i = read(fd, (char*)&ev[n], (NEV - n) * sizeof(ev[0]))) <= 0)
+      break;
+  close(fd);
+
+  // Lost-event markers carry no time; count them apart.
+  lost = 0;
+  for(i = j = 0; i < n; i++){
+    if(ev[i].type == TR_LOST)
+      lost += ev[i].arg[0];
+    else
+      ev[j++] = ev[i];
+  }
+  n = j;
+
+  // Shell sort by TSC; each CPU's events are already in order.
+  for(gap = n/2; gap > 0; gap /= 2)
+    for(i = gap; i < n; i++){
+      t = ev[i];
+      for(j = i; j >= gap && ev[j-gap].tsc > t.tsc; j -= gap)
+        ev[j] = ev[j-gap];
+      ev[j] = t;
+    }
+
+  printf(1, "%s\t%s\t%s\t%s\n", "time(Kc)", "cpu", "pid", "event");
+  for(i = 0; i < n; i++)
+    print(&ev[i], ev[0].tsc);
+  if(lost)
+    printf(1, "%d events lost\n", lost);
+  exit();
+}
@@ -0,0 +1,21 @@
+#define TRACE 2           // major device number of /trace
+#define NTRACE 1024       // events buffered per CPU
+
+// Event types and their arguments.
+#define TR_SYSCALL  1     // number, return value, cycles
+#define TR_PGFLT    2     // va, error code, cycles, 1 if the process was killed
+#define TR_SWTCHOUT 3     // state, chan: the process gives up the CPU
+#define TR_SWTCHIN  4     // MLFQ level: the process is switched to
+#define TR_DISK     5     // block number, 1 if a write, cycles
+#define TR_COMMIT   6     // blocks in the transaction, cycles
+#define TR_LOST     7     // events dropped on this CPU's full ring
+
+// An event read from /trace.
+struct traceev {
+  uint64 tsc;        // TSC when the event was recorded
+  ushort type;
+  uchar cpu;
+  uchar pad;
+  int pid;           // 0 if no process was running
+  uint arg[4];
+};
@@ -7,11 +7,13 @@
 #include "x86.h"
 #include "traps.h"
 #include "spinlock.h"
+#include "trace.h"
 
 // Interrupt descriptor table (shared by all CPUs).
 struct gatedesc idt[256];
 extern uint vectors[];  // in vectors.S: array of 256 entry pointers
 struct spinlock tickslock;
+struct seqlock tickseq;  // lets sys_uptime() read ticks without tickslock
 uint ticks;
 
 void
@@ -24,6 +26,7 @@ tvinit(void)
   SETGATE(idt[T_SYSCALL], 1, SEG_KCODE<<3, vectors[T_SYSCALL], DPL_USER);
 
   initlock(&tickslock, "time");
+  initseqlock(&tickseq);
 }
 
 void
@@ -36,6 +39,9 @@ idtinit(void)
 void
 trap(struct trapframe *tf)
 {
+  uint va, now;
+  uint64 t0;
+
   if(tf->trapno == T_SYSCALL){
     if(myproc()->killed)
       exit();
@@ -50,9 +56,23 @@ trap(struct trapframe *tf)
   case T_IRQ0 + IRQ_TIMER:
     if(cpuid() == 0){
       acquire(&tickslock);
+      writeseqbegin(&tickseq);
       ticks++;
-      wakeup(&ticks);
+      writeseqend(&tickseq);
+      ktimertick(ticks);
+      now = ticks;
       release(&tickslock);
+      // Boost outside tickslock, so sleep() and uptime() callers
+      // don't wait out the scan of ptable.
+      if(now % MLFQBOOST == 0)
+        schedboost();
+    }
+    proftick(tf);
+    if(myproc() && myproc()->state == RUNNING){
+      if((tf->cs & 3) == DPL_USER)
+        myproc()->utime++;
+      else
+        myproc()->stime++;
     }
     lapiceoi();
     break;
@@ -78,6 +98,8 @@ trap(struct trapframe *tf)
     lapiceoi();
     break;
   case T_PGFLT: // Page Fault
+    va = rcr2();
+    t0 = rdtsc();
     if(tf->err & 0x1){
       if(handle_cow_fault() < 0){
         cprintf("pid %d %s: CoW page fault at 0x%x -- killing proc\n",
@@ -92,6 +114,7 @@ trap(struct trapframe *tf)
         myproc()->killed = 1;
       }
     }
+    trace(TR_PGFLT, va, tf->err, rdtsc() - t0, myproc()->killed);
     break;
 
   //PAGEBREAK: 13
@@ -116,10 +139,10 @@ trap(struct trapframe *tf)
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
 
-  // Force process to give up CPU on clock tick.
+  // Force process to give up CPU when its time slice is over.
   // If interrupts were on while locks held, would need to check nlock.
   if(myproc() && myproc()->state == RUNNING &&
-     tf->trapno == T_IRQ0+IRQ_TIMER)
+     tf->trapno == T_IRQ0+IRQ_TIMER && schedtick())
     yield();
 
   // Check if the process has been killed since we yielded
@@ -1,5 +1,12 @@
 struct stat;
 struct rtcdate;
+struct cowstat;
+struct bootstat;
+struct schedstat;
+struct lockstat;
+struct profsample;
+struct syscallstat;
+struct rusage;
 
 // system calls
 int fork(void);
@@ -52,4 +59,74 @@ void* getshared(void);
 int unmapshared(void);
 
 // Part D
-int getNumFreePages(void);
\ No newline at end of file
+int getNumFreePages(void);
+
+// Zygote
+int zygote(void);
+int spawn_from(int, void (*)(void));
+
+// Adaptive CoW
+int getcowstat(struct cowstat*);
+
+// Child-runs-first fork
+int childfirst(int);
+
+// Boot timing
+int getbootstat(struct bootstat*);
+
+// MLFQ scheduler
+int setpriority(int, int);
+int getschedstat(int, struct schedstat*);
+
+// Threads
+int clone(void (*)(void*), void*, void*);
+int join(void**);
+
+// Thread library (uthread.c); malloc is not thread-safe, so create
+// and join threads from one thread.
+typedef struct {
+  volatile uint locked;
+} lock_t;
+
+int thread_create(void (*)(void*), void*);
+int thread_join(void);
+void lock_init(lock_t*);
+void lock_acquire(lock_t*);
+void lock_release(lock_t*);
+
+// Futexes
+int futex_wait(volatile uint*, uint);
+int futex_wake(volatile uint*, int);
+
+// Futex-based mutex and condition variable (ulib.c)
+typedef struct {
+  volatile uint state;  // 0 free, 1 locked, 2 locked with waiters
+} mutex_t;
+
+typedef struct {
+  volatile uint seq;    // bumped by every signal
+} cond_t;
+
+void mutex_init(mutex_t*);
+void mutex_lock(mutex_t*);
+void mutex_unlock(mutex_t*);
+void cond_init(cond_t*);
+void cond_wait(cond_t*, mutex_t*);
+void cond_signal(cond_t*);
+void cond_broadcast(cond_t*);
+
+// Lock statistics
+int getlockstat(struct lockstat*, int);
+int resetlockstat(void);
+
+// Profiling
+int profstart(int);
+int profstop(void);
+int profread(struct profsample*, int);
+
+// System call statistics
+int syscallstat(struct syscallstat*, int);
+
+// Resource usage
+int getrusage(int, struct rusage*);
+int wait2(struct rusage*);
@@ -0,0 +1,70 @@
+// User-level thread library over clone() and join().
+// Kept out of ulib.c, which forktest links without malloc.
+
+#include "types.h"
+#include "user.h"
+#include "x86.h"
+
+// Threads run on a PGSIZE stack from malloc.  Its lowest bytes
+// hold the function and argument, for thread_start() to call.
+#define PGSIZE 4096
+
+struct thread {
+  void (*fn)(void*);
+  void *arg;
+};
+
+static void
+thread_start(void *arg)
+{
+  struct thread *t = arg;
+
+  t->fn(t->arg);
+  exit();
+}
+
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  struct thread *t;
+  int pid;
+
+  if((t = malloc(PGSIZE)) == 0)
+    return -1;
+  t->fn = fn;
+  t->arg = arg;
+  if((pid = clone(thread_start, t, t)) < 0)
+    free(t);
+  return pid;
+}
+
+// Wait for any thread to exit and free its stack.
+int
+thread_join(void)
+{
+  void *stack;
+  int pid;
+
+  if((pid = join(&stack)) >= 0)
+    free(stack);
+  return pid;
+}
+
+void
+lock_init(lock_t *lk)
+{
+  lk->locked = 0;
+}
+
+void
+lock_acquire(lock_t *lk)
+{
+  while(xchg(&lk->locked, 1) != 0)
+    ;
+}
+
+void
+lock_release(lock_t *lk)
+{
+  xchg(&lk->locked, 0);
+}
@@ -6,10 +6,42 @@
 #include "mmu.h"
 #include "proc.h"
 #include "elf.h"
+#include "spinlock.h"
+#include "cowstat.h"
 
 extern char data[];  // defined by kernel.ld
 pde_t *kpgdir;  // for use in scheduler()
 
+// CoW statistics, per CPU and only updated with interrupts off,
+// so they need no lock.  getcowstat() adds them up.
+static struct {
+  struct cowstat stat;
+} __attribute__((aligned(64))) cow[NCPU];
+
+// Address spaces of reaped processes, waiting for an idle CPU
+// to free them (see freevmlater).
+struct {
+  struct spinlock lock;
+  pde_t *pgdir[NPROC];
+  int n;
+} reap;
+
+// Add to this CPU's CoW statistics.
+static void
+cowcount(uint faults, uint copies, uint eager, uint saved, uint wasted)
+{
+  struct cowstat *s;
+
+  pushcli();
+  s = &cow[cpuid()].stat;
+  s->faults += faults;
+  s->copies += copies;
+  s->eager += eager;
+  s->saved += saved;
+  s->wasted += wasted;
+  popcli();
+}
+
 // Set up CPU's kernel segment descriptors.
 // Run once on entry on each CPU.
 void
@@ -21,12 +53,18 @@ seginit(void)
   // Cannot share a CODE descriptor for both kernel and user
   // because it would have to have DPL_USR, but the CPU forbids
   // an interrupt from CPL=0 to DPL=3.
-  c = &cpus[cpuid()];
+  c = findcpu();
   c->gdt[SEG_KCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, 0);
   c->gdt[SEG_KDATA] = SEG(STA_W, 0, 0xffffffff, 0);
   c->gdt[SEG_UCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, DPL_USER);
   c->gdt[SEG_UDATA] = SEG(STA_W, 0, 0xffffffff, DPL_USER);
+
+  // Map %gs to this CPU's struct cpu, for mycpu() and myproc().
+  // alltraps reloads %gs, which user code may have changed.
+  c->self = c;
+  c->gdt[SEG_KCPU] = SEG(STA_W, c, sizeof(*c) - 1, 0);
   lgdt(c->gdt, sizeof(c->gdt));
+  loadgs(SEG_KCPU << 3);
 }
 
 // Return the address of the PTE in page table pgdir
@@ -140,6 +178,7 @@ setupkvm(void)
 void
 kvmalloc(void)
 {
+  initlock(&reap.lock, "reap");
   kpgdir = setupkvm();
   switchkvm();
 }
@@ -216,32 +255,105 @@ loaduvm(pde_t *pgdir, char *addr, struct inode *ip, uint offset, uint sz)
   return 0;
 }
 
+// Load a program segment of filesz bytes at offset in ip to addr,
+// growing the image from oldsz to addr+memsz.  File-backed pages come
+// from the text cache and are mapped read-only, so processes running
+// the same binary share them until a write breaks the sharing through
+// a CoW fault.  Whatever the cache cannot supply is allocated and read
+// privately.  addr must be page-aligned.  Returns new size or 0 on error.
+int
+loadseg(pde_t *pgdir, uint oldsz, char *addr, struct inode *ip,
+        uint offset, uint filesz, uint memsz)
+{
+  uint a, n, sz;
+  char *mem;
+
+  if((uint) addr % PGSIZE != 0)
+    panic("loadseg: addr must be page aligned");
+  sz = oldsz;
+  if((uint)addr > sz && (sz = allocuvm(pgdir, sz, (uint)addr)) == 0)
+    return 0;
+
+  a = (uint)addr;
+  if(a >= PGROUNDUP(sz)){
+    for(; a < (uint)addr + filesz; a += PGSIZE){
+      n = (uint)addr + filesz - a;
+      if(n > PGSIZE)
+        n = PGSIZE;
+      if((mem = textpage(ip, offset + (a - (uint)addr), n)) == 0)
+        break;
+      if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_U) < 0){
+        kfree(mem);
+        return 0;
+      }
+      sz = a + PGSIZE;
+    }
+  }
+
+  if((sz = allocuvm(pgdir, sz, (uint)addr + memsz)) == 0)
+    return 0;
+  if(a < (uint)addr + filesz &&
+     loaduvm(pgdir, (char*)a, ip, offset + (a - (uint)addr),
+             (uint)addr + filesz - a) < 0)
+    return 0;
+  return sz;
+}
+
+// Pages on their way to kfree_bulk(), so that tearing down an
+// address space takes the allocator locks once per NPGBATCH pages.
+struct pgbatch {
+  int n;
+  char *pg[NPGBATCH];
+};
+
+static void
+pgflush(struct pgbatch *b)
+{
+  if(b->n > 0)
+    kfree_bulk(b->pg, b->n);
+  b->n = 0;
+}
+
+static void
+pgfree(struct pgbatch *b, char *v)
+{
+  b->pg[b->n++] = v;
+  if(b->n == NPGBATCH)
+    pgflush(b);
+}
+
 // Allocate page tables and physical memory to grow process from oldsz to
 // newsz, which need not be page aligned.  Returns new size or 0 on error.
 int
 allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 {
-  char *mem;
+  char *mem[NPGBATCH];
   uint a;
+  int i, n, got;
 
-  if(newsz >= KERNBASE)
+  if(newsz > KERNBASE)
     return 0;
   if(newsz < oldsz)
     return oldsz;
 
   a = PGROUNDUP(oldsz);
-  for(; a < newsz; a += PGSIZE){
-    mem = kalloc();
-    if(mem == 0){
-      cprintf("allocuvm out of memory\n");
-      deallocuvm(pgdir, newsz, oldsz);
-      return 0;
+  while(a < newsz){
+    n = (newsz - a + PGSIZE - 1) / PGSIZE;
+    if(n > NPGBATCH)
+      n = NPGBATCH;
+    got = kalloc_bulk(n, mem);
+    for(i = 0; i < got; i++, a += PGSIZE){
+      memset(mem[i], 0, PGSIZE);
+      if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem[i]), PTE_W|PTE_U) < 0){
+        cprintf("allocuvm out of memory (2)\n");
+        deallocuvm(pgdir, newsz, oldsz);
+        kfree_bulk(mem + i, got - i);
+        return 0;
+      }
     }
-    memset(mem, 0, PGSIZE);
-    if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
-      cprintf("allocuvm out of memory (2)\n");
+    if(got < n){
+      cprintf("allocuvm out of memory\n");
       deallocuvm(pgdir, newsz, oldsz);
-      kfree(mem);
       return 0;
     }
   }
@@ -256,29 +368,40 @@ int
 deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 {
   pte_t *pte;
-  uint a, pa;
+  uint a, pa, saved, wasted;
+  struct pgbatch b;
 
   if(newsz >= oldsz)
     return oldsz;
 
+  b.n = 0;
+  saved = wasted = 0;
   a = PGROUNDUP(newsz);
   for(; a  < oldsz; a += PGSIZE){
     pte = walkpgdir(pgdir, (char*)a, 0);
     if(!pte)
       a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
     else if((*pte & PTE_P) != 0){
+      if(*pte & PTE_EC){
+        if(*pte & PTE_D)
+          saved++;
+        else
+          wasted++;
+      }
 
       if((*pte & PTE_S) == 0){
         pa = PTE_ADDR(*pte);
         if(pa == 0)
           panic("kfree");
-        char *v = P2V(pa);
-        kfree(v);
+        pgfree(&b, P2V(pa));
       }
       *pte = 0;
 
     }
   }
+  pgflush(&b);
+  if(saved || wasted)
+    cowcount(0, 0, 0, saved, wasted);
   return newsz;
 }
 
@@ -288,45 +411,97 @@ void
 freevm(pde_t *pgdir)
 {
   uint i;
+  struct pgbatch b;
 
   if(pgdir == 0)
     panic("freevm: no pgdir");
   deallocuvm(pgdir, KERNBASE, 0);
+  b.n = 0;
   for(i = 0; i < NPDENTRIES; i++){
-    if(pgdir[i] & PTE_P){
-      char * v = P2V(PTE_ADDR(pgdir[i]));
-      kfree(v);
-    }
+    if(pgdir[i] & PTE_P)
+      pgfree(&b, P2V(PTE_ADDR(pgdir[i])));
   }
-  kfree((char*)pgdir);
+  pgfree(&b, (char*)pgdir);
+  pgflush(&b);
 }
 
-// Clear PTE_U on a page. Used to create an inaccessible
-// page beneath the user stack.
-void
-clearpteu(pde_t *pgdir, char *uva)
+// Queue pgdir to be freed later, when a CPU has nothing else to
+// run, so that wait() does not pay for tearing down a large child.
+// Returns -1 if too many are already queued: the caller must then
+// freevm() it, after dropping any locks it holds.
+int
+freevmlater(pde_t *pgdir)
 {
-  pte_t *pte;
+  if(pgdir == 0)
+    panic("freevmlater: no pgdir");
+  acquire(&reap.lock);
+  if(reap.n < NELEM(reap.pgdir)){
+    reap.pgdir[reap.n++] = pgdir;
+    release(&reap.lock);
+    return 0;
+  }
+  release(&reap.lock);
+  return -1;
+}
 
-  pte = walkpgdir(pgdir, uva, 0);
-  if(pte == 0)
-    panic("clearpteu");
-  *pte &= ~PTE_U;
+// Free up to n queued address spaces, or all of them if n < 0.
+// Called by idle CPUs in scheduler() and, when memory runs out,
+// by kalloc().  Returns the number freed.
+int
+reapvm(int n)
+{
+  pde_t *pgdir;
+  int done;
+
+  for(done = 0; n < 0 || done < n; done++){
+    // Unlocked peek: idle CPUs call this in a loop.
+    if(reap.n == 0)
+      break;
+    acquire(&reap.lock);
+    if(reap.n == 0){
+      release(&reap.lock);
+      break;
+    }
+    pgdir = reap.pgdir[--reap.n];
+    release(&reap.lock);
+    freevm(pgdir);
+  }
+  return done;
 }
 
 // Given a parent process's page table, create a copy
 // of it for a child.
+//
+// Pages are shared copy-on-write, except pages the parent wrote both
+// before the previous fork and since it (PTE_WH and PTE_D): those are
+// almost always written again right away, by the parent's stack or by
+// the child, so the child gets its own copy now instead of a CoW fault
+// later.  The dirty bits are sampled and cleared on every fork; the
+// caller must flush the parent's TLB so the CPU sets them again.
+// If shared, other threads' CPUs may cache pgdir's PTEs, so none of
+// them may lose PTE_W: every private page is copied.  Those CPUs may
+// also be setting A and D in the PTEs, so they are left untouched and
+// the dirty bits are not sampled.
+// The user pages are those below sz and from stack to USTACKTOP.
 pde_t*
-copyuvm(pde_t *pgdir, uint sz)
+copyuvm(pde_t *pgdir, uint sz, uint stack, int shared)
 {
   pde_t *d;
   pte_t *pte;
   uint pa, i, flags;
+  uint eager, saved, wasted;
+  char *mem;
+  int hot;
 
   if((d = setupkvm()) == 0)
     return 0;
 
-  for(i = 0; i < sz; i += PGSIZE){
+  eager = saved = wasted = 0;
+  for(i = 0; i < USTACKTOP; i += PGSIZE){
+    if(i >= sz && i < stack){
+      i = stack - PGSIZE;  // skip the hole between heap and stack
+      continue;
+    }
     if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
       panic("copyuvm: pte should exist");
 
@@ -340,6 +515,38 @@ copyuvm(pde_t *pgdir, uint sz)
     if(flags & PTE_S){
       if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0)
         goto bad;
+      continue;
+    }
+
+    hot = 0;
+    if(!shared){
+      // Did the last eager copy of this page pay off for the parent?
+      if(flags & PTE_EC){
+        if(flags & PTE_D)
+          saved++;
+        else
+          wasted++;
+      }
+
+      // Remember whether this page was written since the last fork.
+      hot = (flags & (PTE_W | PTE_D | PTE_WH)) == (PTE_W | PTE_D | PTE_WH);
+      *pte &= ~(PTE_D | PTE_WH | PTE_EC);
+      if(flags & PTE_D)
+        *pte |= PTE_WH;
+    }
+
+    flags &= ~(PTE_A | PTE_D | PTE_WH | PTE_EC);
+    if((hot || shared) && (mem = kalloc()) != 0){
+      memmove(mem, (char*)P2V(pa), PGSIZE);
+      if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags | PTE_EC) < 0){
+        kfree(mem);
+        goto bad;
+      }
+      if(!shared)
+        *pte |= PTE_EC;
+      eager++;
+    } else if(shared){
+      goto bad;
     } else {
       flags &= ~PTE_W;
 
@@ -352,12 +559,130 @@ copyuvm(pde_t *pgdir, uint sz)
     }
   }
 
+  cowcount(0, 0, eager, saved, wasted);
+
   return d;
 
 bad:
   freevm(d);
   return 0;
 }
+// Write-protect every private page of pgdir once, so that its pages
+// can later be shared with cloneuvm() without touching pgdir again.
+// Caller must flush the TLB if pgdir is live.
+void
+wrprotectuvm(pde_t *pgdir, uint sz, uint stack)
+{
+  pte_t *pte;
+  uint i;
+
+  for(i = 0; i < USTACKTOP; i += PGSIZE){
+    if(i >= sz && i < stack){
+      i = stack - PGSIZE;  // skip the hole between heap and stack
+      continue;
+    }
+    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
+      continue;
+    if((*pte & PTE_P) && !(*pte & PTE_S))
+      *pte &= ~PTE_W;
+  }
+}
+
+// Make the copy-on-write page at pte writable, copying it first if
+// other address spaces still share it.  Returns 1 if it copied,
+// 0 if not, -1 if out of memory.
+static int
+cowbreak(pte_t *pte)
+{
+  uint pa, flags;
+  char *mem;
+  int ref_count;
+
+  pa = PTE_ADDR(*pte);
+  flags = PTE_FLAGS(*pte);
+  ref_count = get_ref(P2V(pa));
+
+  if(ref_count > 1){
+    if((mem = kalloc()) == 0)
+      return -1;
+
+    memmove(mem, (char*)P2V(pa), PGSIZE);
+
+    dec_ref(P2V(pa));
+
+    *pte = V2P(mem) | ( (flags | PTE_W) & ~PTE_S );
+    return 1;
+
+  } else if(ref_count == 1) {
+    *pte |= PTE_W;
+
+  } else {
+    panic("cowbreak: ref count <= 0");
+  }
+  return 0;
+}
+
+// Break every copy-on-write page of pgdir before threads share it,
+// as no CPU could then be sure the others dropped the old page.
+// Returns -1 if out of memory.  Caller must flush the TLB.
+int
+unshareuvm(pde_t *pgdir, uint sz, uint stack)
+{
+  pte_t *pte;
+  uint i;
+
+  for(i = 0; i < USTACKTOP; i += PGSIZE){
+    if(i >= sz && i < stack){
+      i = stack - PGSIZE;  // skip the hole between heap and stack
+      continue;
+    }
+    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
+      continue;
+    if((*pte & (PTE_P | PTE_W | PTE_S)) == PTE_P && cowbreak(pte) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+// Like copyuvm(), but for a page table already write-protected by
+// wrprotectuvm(): the child shares every page copy-on-write and the
+// parent's PTEs are left as they are.
+pde_t*
+cloneuvm(pde_t *pgdir, uint sz, uint stack)
+{
+  pde_t *d;
+  pte_t *pte;
+  uint pa, i, flags;
+
+  if((d = setupkvm()) == 0)
+    return 0;
+
+  for(i = 0; i < USTACKTOP; i += PGSIZE){
+    if(i >= sz && i < stack){
+      i = stack - PGSIZE;  // skip the hole between heap and stack
+      continue;
+    }
+    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
+      continue;
+    if(!(*pte & PTE_P))
+      continue;
+
+    pa = PTE_ADDR(*pte);
+    flags = PTE_FLAGS(*pte);
+    if(!(flags & PTE_S))
+      flags &= ~(PTE_W | PTE_A | PTE_D | PTE_WH | PTE_EC);
+    if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0)
+      goto bad;
+    if(!(flags & PTE_S))
+      inc_ref(P2V(pa));
+  }
+  return d;
+
+bad:
+  freevm(d);
+  return 0;
+}
+
 //PAGEBREAK!
 // Map user virtual address to kernel address.
 char*
@@ -366,7 +691,7 @@ uva2ka(pde_t *pgdir, char *uva)
   pte_t *pte;
 
   pte = walkpgdir(pgdir, uva, 0);
-  if((*pte & PTE_P) == 0)
+  if(pte == 0 || (*pte & PTE_P) == 0)
     return 0;
   if((*pte & PTE_U) == 0)
     return 0;
@@ -407,7 +732,8 @@ count_virtual_pages(void)
 
   // PGROUNDUP rounds sz up to the nearest page size.
   // Then we divide by PGSIZE to get the number of pages.
-  return PGROUNDUP(sz) / PGSIZE;
+  // The stack pages sit apart, below USTACKTOP.
+  return PGROUNDUP(sz) / PGSIZE + (USTACKTOP - curproc->stack) / PGSIZE;
 }
 
 int
@@ -452,17 +778,53 @@ count_page_table_pages(void)
   return count;
 }
 
+// Map a zero page at va, which must lie in the stack reserve, and
+// lower p->stack to it if needed.  Only that page is mapped: a touch
+// far below the stack (the end of a large local array, say) must not
+// commit the whole range.  The unmapped pages between p->stack and
+// USTACKTOP fault in the same way when used.
+int
+growstack(struct proc *p, uint va)
+{
+  uint a;
+
+  if(va < USTACKBASE || va >= USTACKTOP)
+    return -1;
+  a = PGROUNDDOWN(va);
+  if(allocuvm(p->pgdir, a, a + PGSIZE) == 0)
+    return -1;
+  if(a < p->stack)
+    p->stack = a;
+  return 0;
+}
+
+// Map a zero page at the faulting address, or grow the stack.
+// Another thread may have mapped the page since the fault.
 int
 handle_page_fault(void)
 {
   struct proc *curproc = myproc();
   uint va;
+  pte_t *pte;
   char *mem;
 
   va = rcr2();
 
+  vmlock(curproc);
+
+  if(va < KERNBASE && (pte = walkpgdir(curproc->pgdir, (void*)va, 0)) != 0 &&
+     (*pte & PTE_P))
+    goto done;
+
+  if(va >= USTACKBASE && va < USTACKTOP){
+    if(growstack(curproc, va) < 0)
+      goto bad;
+    curproc->zfill++;
+    goto done;
+  }
+
   if(va >= curproc->sz || va >= KERNBASE){
-    return -1; 
+    goto bad;
   }
 
   va = PGROUNDDOWN(va);
@@ -470,7 +832,7 @@ handle_page_fault(void)
   mem = kalloc();
   if(mem == 0){
     cprintf("handle_page_fault: out of memory\n");
-    return -1; 
+    goto bad;
   }
 
   memset(mem, 0, PGSIZE);
@@ -478,25 +840,38 @@ handle_page_fault(void)
   if(mappages(curproc->pgdir, (void*)va, PGSIZE, V2P(mem), PTE_W | PTE_U) < 0){
     cprintf("handle_page_fault: mappages failed\n");
     kfree(mem); 
-    return -1; 
+    goto bad;
   }
+  curproc->zfill++;
 
+done:
+  curproc->minflt++;
+  vmunlock(curproc);
   lcr3(V2P(curproc->pgdir));
-
   return 0; 
+
+bad:
+  vmunlock(curproc);
+  return -1;
 }
 
 int
 mappageshared(void)
 {
   struct proc *curproc = myproc();
-  uint va = curproc->sz; 
+  uint va;
   char *mem;
 
+  vmlock(curproc);
+  va = curproc->sz;
+
+  if(va + PGSIZE > USTACKBASE)
+    goto bad;
+
   mem = kalloc();
   if(mem == 0){
     cprintf("mappageshared: out of memory\n");
-    return 0; 
+    goto bad;
   }
 
   memset(mem, 0, PGSIZE);
@@ -504,14 +879,19 @@ mappageshared(void)
   if(mappages(curproc->pgdir, (void*)va, PGSIZE, V2P(mem), PTE_W | PTE_U | PTE_S) < 0){
     cprintf("mappageshared: mappages failed\n");
     kfree(mem); 
-    return 0; 
+    goto bad;
   }
 
   curproc->sz += PGSIZE;
 
+  vmunlock(curproc);
   lcr3(V2P(curproc->pgdir));
 
   return va;
+
+bad:
+  vmunlock(curproc);
+  return 0;
 }
 
 int
@@ -550,6 +930,10 @@ unmapsharedpage(void)
   uint pa;
   uint va = 0;
 
+  // Threads can't unmap: another CPU may have the page in its TLB.
+  if(curproc->vm)
+    return -1;
+
   // First, find the virtual address of the shared page
   // (This logic is identical to findsharedva)
   for(int i = 0; i < PDX(KERNBASE); i++){
@@ -591,54 +975,64 @@ handle_cow_fault(void)
   pde_t *pgdir = curproc->pgdir;
   uint va;
   pte_t *pte;
-  uint pa;
-  uint flags;
-  char *mem;
-  int ref_count;
+  int copied;
 
   va = rcr2();
 
-  if(va >= KERNBASE || va >= curproc->sz){
+  if(va >= KERNBASE || (va >= curproc->sz && va < curproc->stack)){
     return -1; 
   }
 
   va = PGROUNDDOWN(va);
 
+  vmlock(curproc);
+
   pte = walkpgdir(pgdir, (void*)va, 0);
   if(pte == 0)
-    return -1; 
+    goto bad;
 
   if(!(*pte & PTE_P))
-    return -1; 
+    goto bad;
 
-  pa = PTE_ADDR(*pte);
-  flags = PTE_FLAGS(*pte);
+  // Another thread broke it first.
+  if(*pte & PTE_W)
+    goto done;
 
-  ref_count = get_ref(P2V(pa));
-
-  if(ref_count > 1){
-    mem = kalloc();
-    if(mem == 0){
-      cprintf("handle_cow_fault: out of memory\n");
-      return -1;
-    }
-
-    memmove(mem, (char*)P2V(pa), PGSIZE);
-
-    dec_ref(P2V(pa));
-
-    *pte = V2P(mem) | ( (flags | PTE_W) & ~PTE_S );
-
-  } else if(ref_count == 1) {
-    *pte |= PTE_W;
-
-  } else {
-    panic("handle_cow_fault: ref count <= 0");
+  if((copied = cowbreak(pte)) < 0){
+    cprintf("handle_cow_fault: out of memory\n");
+    goto bad;
   }
+  cowcount(1, copied, 0, 0, 0);
+  curproc->cowflt++;
 
+done:
+  curproc->minflt++;
+  vmunlock(curproc);
   lcr3(V2P(pgdir));
-
   return 0; 
+
+bad:
+  vmunlock(curproc);
+  return -1;
+}
+
+// Copy the CoW fork statistics, summed over CPUs, to st, which may
+// be a user address: a CoW fault on it counts, so sum first.
+void
+getcowstat(struct cowstat *st)
+{
+  struct cowstat s;
+  int c;
+
+  memset(&s, 0, sizeof(s));
+  for(c = 0; c < ncpu; c++){
+    s.faults += cow[c].stat.faults;
+    s.copies += cow[c].stat.copies;
+    s.eager += cow[c].stat.eager;
+    s.saved += cow[c].stat.saved;
+    s.wasted += cow[c].stat.wasted;
+  }
+  *st = s;
 }
 
 //PAGEBREAK!